@@ -0,0 +1,341 @@
+/**
+ * @file c_strings_benchmark.cpp
+ *
+ * Benchmarks the scanning functions of cs19_c_strings.h against their glibc counterparts in
+ * <cstring>, on a short log line and on longer strings, reporting GB/s for each. strstr is timed
+ * with an 11-char and a 65-char needle, and cs19::SubstringSearcher with its needle preprocessed.
+ * The std::string_view overloads of strchr() and strrchr() are compared against memchr() and
+ * memrchr(), and the string_view strstr() against std::string_view::find(). strcmp() and
+ * memcmp() are timed on two copies of the string that differ only in their last char.
+ *
+ * A second table compares cs19::parse_integers() against a loop over std::from_chars() on a column
+ * of comma-separated 32- and 64-bit integers of varying lengths.
+ *
+ * Another table times cs19::sort_strings() against std::sort() with std::strcmp() on a million
+ * URL-like C strings with long common prefixes.
+ *
+ * Another table times the in-place transforms cs19::strrev() and cs19::str_rot13() on buffers of
+ * 1 KiB to 64 MiB, against std::reverse() and a loop encoding one char at a time.
+ *
+ * The last table times cs19::MultiSubstringSearcher::find_all() with 10 to 100000 random keywords
+ * over max_length chars of log-like text, reporting GB/s, the number of matches, and the
+ * milliseconds taken to compile the keywords. The prefix filter passes about as few positions for
+ * 100000 keywords as for 10, so scanning holds its speed through 10000 keywords. Past that, more
+ * positions really begin a keyword's prefix, and walking the trie from them misses cache, so 100000
+ * keywords scan at about half the speed of 10000.
+ *
+ * Before timing, every function is checked against glibc on strings that end exactly at a page
+ * boundary followed by an inaccessible page, so an over-read past the terminator would crash. The
+ * string_view overloads are checked on unterminated chars that end at the boundary.
+ *
+ * Build: g++ -std=c++17 -O2 c_strings_benchmark.cpp cs19_c_strings.cpp -o c_strings_benchmark
+ * Usage: c_strings_benchmark [max_length]  (default 16777216)
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "cs19_c_strings.h"
+
+namespace {
+
+volatile std::size_t sink = 0;  // keeps the optimizer from discarding results
+
+// Runs fn repeatedly until at least ~0.2 s have elapsed; returns mean seconds per call. Calls are
+// made in batches, so reading the clock does not dominate the time of calls on short strings.
+template <typename Function>
+double time_per_call(Function fn) {
+  using clock = std::chrono::steady_clock;
+  std::size_t calls = 0;
+  auto start = clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+    for (int batch = 0; batch < 64; ++batch)
+      fn();
+    calls += 64;
+    elapsed = clock::now() - start;
+  } while (elapsed.count() < 0.2);
+  return elapsed.count() / calls;
+}
+
+// Log-like text: lowercase words, digits, spaces and '=' but none of the chars searched for below
+std::string log_text(std::size_t length, unsigned seed) {
+  std::mt19937 engine(seed);
+  const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789 =";
+  std::string text(length, ' ');
+  for (auto &c : text)
+    c = alphabet[engine() % (sizeof alphabet - 1)];
+  return text;
+}
+
+void verify_at_page_boundary() {
+  long page = sysconf(_SC_PAGESIZE);
+  auto *memory = static_cast<char *>(
+      mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  assert(memory != MAP_FAILED);
+  mprotect(memory + page, page, PROT_NONE);
+  std::mt19937 engine(7);
+  for (std::size_t length = 0; length < 300; ++length) {
+    char *str = memory + page - length - 1;  // the terminator is the last accessible byte
+    for (std::size_t i = 0; i < length; ++i)
+      str[i] = "abcXYZ \x80\xff"[engine() % 9];
+    str[length] = '\0';
+    assert(cs19::strlen(str) == std::strlen(str));
+    for (char c : {'a', 'X', 'q', '\x80', '\xff'}) {
+      assert(cs19::strchr(str, c) == std::strchr(str, c));
+      assert(cs19::strrchr(str, c) == std::strrchr(str, c));
+    }
+    for (const char *chars : {"a", "XZ", "q", " \xff", "cba"})
+      assert(cs19::strpbrk(str, chars) == std::strpbrk(str, chars));
+    for (const char *needle : {"a", "ab", "Xa", "cXYZ", "\xff\x80", "zz"})
+      assert(cs19::strstr(str, needle) == std::strstr(str, needle));
+    const char *other = memory + page / 2;  // a copy of str, not page-aligned the same way
+    std::memcpy(const_cast<char *>(other), str, length + 1);
+    assert(cs19::strcmp(str, other) == 0 && cs19::strcmp(other, str) == 0);
+    assert(cs19::strncmp(str, other, length + 5) == 0);
+
+    std::string_view view(memory + page - length, length);  // no terminator
+    for (char c : {'a', 'X', 'q', '\x80', '\xff'}) {
+      assert(cs19::strchr(view, c) == std::memchr(view.data(), c, length));
+      assert(cs19::strrchr(view, c) == memrchr(view.data(), c, length));
+    }
+    for (const char *chars : {"a", "XZ", "q", " \xff", "cba"}) {
+      std::size_t i = view.find_first_of(chars);
+      assert(cs19::strpbrk(view, chars) == (i == view.npos ? nullptr : view.data() + i));
+    }
+    for (const char *needle : {"a", "ab", "Xa", "cXYZ", "\xff\x80", "zz"}) {
+      std::size_t i = view.find(needle);
+      assert(cs19::strstr(view, needle) == (i == view.npos ? nullptr : view.data() + i));
+    }
+  }
+  munmap(memory, 2 * page);
+}
+
+void report(const char *function, std::size_t length, double cs19_seconds, double glibc_seconds) {
+  std::printf("%-9s %10zu %10.2f %10.2f %9.2fx\n", function, length, length / cs19_seconds / 1e9,
+              length / glibc_seconds / 1e9, glibc_seconds / cs19_seconds);
+}
+
+// Each function is timed on a search that must scan the whole string before succeeding at its end
+// (or, scanning backward from the end, failing at the start).
+void benchmark(std::size_t length) {
+  std::string text = log_text(length, 1), needle = "status=503#";
+  std::string long_needle = "request_id=" + log_text(53, 2) + "#";  // 65 chars
+  if (length >= long_needle.size() + needle.size())
+    text.replace(length - long_needle.size() - needle.size(), long_needle.size(), long_needle);
+  text.replace(length - needle.size(), needle.size(), needle);
+  const char *str = text.c_str(), *word = needle.c_str(), *long_word = long_needle.c_str();
+  cs19::SubstringSearcher searcher(word);
+  std::string_view view = text, needle_view = needle;
+  std::string copy = text;
+  copy.back() = '$';
+  const char *other = copy.c_str();
+
+  assert(cs19::strlen(str) == std::strlen(str));
+  assert(cs19::strchr(str, '#') == std::strchr(str, '#'));
+  assert(cs19::strrchr(str, 's') == std::strrchr(str, 's'));
+  assert(cs19::strpbrk(str, "#[]{}") == std::strpbrk(str, "#[]{}"));
+  assert(cs19::strstr(str, word) == std::strstr(str, word));
+  assert(cs19::strstr(str, long_word) == std::strstr(str, long_word));
+  assert(searcher.find(str) == std::strstr(str, word));
+
+  report("strlen", length, time_per_call([&] { sink = sink + cs19::strlen(str); }),
+         time_per_call([&] { sink = sink + std::strlen(str); }));
+  report("strchr", length, time_per_call([&] { sink = sink + !!cs19::strchr(str, '#'); }),
+         time_per_call([&] { sink = sink + !!std::strchr(str, '#'); }));
+  report("strrchr", length, time_per_call([&] { sink = sink + !!cs19::strrchr(str, 's'); }),
+         time_per_call([&] { sink = sink + !!std::strrchr(str, 's'); }));
+  report("strpbrk", length, time_per_call([&] { sink = sink + !!cs19::strpbrk(str, "#[]{}"); }),
+         time_per_call([&] { sink = sink + !!std::strpbrk(str, "#[]{}"); }));
+  report("strstr", length, time_per_call([&] { sink = sink + !!cs19::strstr(str, word); }),
+         time_per_call([&] { sink = sink + !!std::strstr(str, word); }));
+  report("strstr65", length, time_per_call([&] { sink = sink + !!cs19::strstr(str, long_word); }),
+         time_per_call([&] { sink = sink + !!std::strstr(str, long_word); }));
+  report("searcher", length, time_per_call([&] { sink = sink + !!searcher.find(str); }),
+         time_per_call([&] { sink = sink + !!std::strstr(str, word); }));
+  report("strcmp", length, time_per_call([&] { sink = sink + cs19::strcmp(str, other); }),
+         time_per_call([&] { sink = sink + std::strcmp(str, other); }));
+  report("memcmp", length, time_per_call([&] { sink = sink + cs19::memcmp(str, other, length); }),
+         time_per_call([&] { sink = sink + std::memcmp(str, other, length); }));
+  report("strchr_n", length, time_per_call([&] { sink = sink + !!cs19::strchr(view, '#'); }),
+         time_per_call([&] { sink = sink + !!std::memchr(str, '#', length); }));
+  report("strrchr_n", length, time_per_call([&] { sink = sink + !!cs19::strrchr(view, '['); }),
+         time_per_call([&] { sink = sink + !!memrchr(str, '[', length); }));
+  report("strstr_n", length,
+         time_per_call([&] { sink = sink + !!cs19::strstr(view, needle_view); }),
+         time_per_call([&] { sink = sink + view.find(needle_view); }));
+}
+
+template <typename Integer>
+void benchmark_parsing(const char *type, std::size_t count) {
+  std::mt19937_64 engine(3);
+  std::string csv;
+  for (std::size_t i = 0; i < count; ++i) {
+    auto value = static_cast<Integer>(engine() >> (engine() % 64));  // all magnitudes
+    csv += std::to_string(value) + ',';
+  }
+  const char *first = csv.data(), *last = first + csv.size();
+  std::vector<Integer> parsed, expected;
+  parsed.reserve(count);
+  expected.reserve(count);
+  auto cs19_parse = [&] {
+    parsed.clear();
+    sink = sink + static_cast<std::size_t>(cs19::parse_integers(first, last, ',', parsed).ec);
+  };
+  auto std_parse = [&] {
+    expected.clear();
+    for (const char *p = first; p != last; ++p) {
+      Integer value;
+      p = std::from_chars(p, last, value).ptr;
+      expected.push_back(value);
+    }
+  };
+  cs19_parse();
+  std_parse();
+  assert(parsed == expected);
+  double cs19_seconds = time_per_call(cs19_parse), std_seconds = time_per_call(std_parse);
+  std::printf("%-9s %10zu %10.1f %10.1f %9.2fx\n", type, count, count / cs19_seconds / 1e6,
+              count / std_seconds / 1e6, std_seconds / cs19_seconds);
+}
+
+void benchmark_sorting(std::size_t count) {
+  std::mt19937 engine(5);
+  const char *hosts[] = {"https://example.com/", "https://example.org/api/v2/", "http://a.io/"};
+  std::vector<std::string> urls(count);
+  for (auto &url : urls)
+    url = hosts[engine() % 3] + log_text(4 + engine() % 8, engine()) + "/" +
+          std::to_string(engine() % 100000);
+  std::vector<const char *> original;
+  for (const auto &url : urls)
+    original.push_back(url.c_str());
+  std::vector<const char *> sorted = original, expected = original;
+  cs19::sort_strings(sorted.data(), sorted.data() + count);
+  std::sort(expected.begin(), expected.end(),
+            [](const char *a, const char *b) { return std::strcmp(a, b) < 0; });
+  for (std::size_t i = 0; i < count; ++i)
+    assert(std::strcmp(sorted[i], expected[i]) == 0);
+
+  // Each sort takes long enough to time on its own, so take the best of a few
+  auto best_of_3 = [&](auto sort) {
+    double best = 1e9;
+    for (int run = 0; run < 3; ++run) {
+      sorted = original;
+      auto start = std::chrono::steady_clock::now();
+      sort();
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                                .count());
+    }
+    return best;
+  };
+  double cs19_seconds =
+      best_of_3([&] { cs19::sort_strings(sorted.data(), sorted.data() + count); });
+  double std_seconds = best_of_3([&] {
+    std::sort(sorted.begin(), sorted.end(),
+              [](const char *a, const char *b) { return std::strcmp(a, b) < 0; });
+  });
+  std::printf("%-9s %10zu %10.1f %10.1f %9.2fx\n", "sort", count, count / cs19_seconds / 1e6,
+              count / std_seconds / 1e6, std_seconds / cs19_seconds);
+}
+
+// ROT13 one char at a time, as a baseline
+void rot13_chars(char *str, std::size_t length) {
+  for (char *end = str + length; str != end; ++str) {
+    char lower = static_cast<char>(*str | 0x20);
+    if (lower >= 'a' && lower <= 'z')
+      *str = static_cast<char>(lower <= 'm' ? *str + 13 : *str - 13);
+  }
+}
+
+void benchmark_transforms(std::size_t length) {
+  std::string text = log_text(length, 4);
+  for (std::size_t i = 0; i < length; i += 3)
+    text[i] = static_cast<char>(text[i] & ~0x20);  // some uppercase too
+  std::string expected = text;
+  cs19::strrev(text.data(), length);
+  std::reverse(expected.begin(), expected.end());
+  assert(text == expected);
+  cs19::str_rot13(text.data(), length);
+  rot13_chars(expected.data(), length);
+  assert(text == expected);
+
+  char *data = text.data();
+  double cs19_seconds = time_per_call([&] { cs19::strrev(data, length); });
+  double baseline_seconds = time_per_call([&] { std::reverse(data, data + length); });
+  std::printf("%-9s %10zu %10.2f %10.2f %9.2fx\n", "strrev", length, length / cs19_seconds / 1e9,
+              length / baseline_seconds / 1e9, baseline_seconds / cs19_seconds);
+  cs19_seconds = time_per_call([&] { cs19::str_rot13(data, length); });
+  baseline_seconds = time_per_call([&] { rot13_chars(data, length); });
+  std::printf("%-9s %10zu %10.2f %10.2f %9.2fx\n", "rot13", length, length / cs19_seconds / 1e9,
+              length / baseline_seconds / 1e9, baseline_seconds / cs19_seconds);
+  sink = sink + static_cast<unsigned char>(data[0]);
+}
+
+void benchmark_multi_search(std::size_t count, const std::string &text) {
+  std::mt19937 engine(6);
+  std::vector<std::string> patterns(count);
+  for (auto &pattern : patterns)
+    pattern = log_text(5 + engine() % 8, engine());
+  auto start = std::chrono::steady_clock::now();
+  cs19::MultiSubstringSearcher searcher(patterns);
+  double build_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::vector<cs19::SubstringMatch> matches;
+  searcher.find_all(text, matches);
+  for (const auto &match : matches)
+    assert(text.compare(match.offset, patterns[match.pattern].size(), patterns[match.pattern]) ==
+           0);
+
+  // A scan of many patterns takes long enough to time on its own, so take the best of a few
+  double best = 1e9;
+  for (int run = 0; run < 3; ++run) {
+    matches.clear();
+    start = std::chrono::steady_clock::now();
+    searcher.find_all(text, matches);
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                              .count());
+  }
+  std::printf("%-9s %10zu %10.2f %10zu %10.1f\n", "find_all", count, text.size() / best / 1e9,
+              matches.size(), build_seconds * 1e3);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::size_t max_length = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 24;
+  verify_at_page_boundary();
+  std::printf("%-9s %10s %10s %10s %10s\n", "function", "length", "cs19 GB/s", "glibc GB/s",
+              "speedup");
+  for (std::size_t length = 128; length <= max_length; length *= 32)
+    benchmark(length);
+  std::printf("\n%-9s %10s %10s %10s %10s\n", "type", "fields", "cs19 M/s", "std M/s", "speedup");
+  benchmark_parsing<std::int32_t>("int32", 1 << 20);
+  benchmark_parsing<std::uint64_t>("uint64", 1 << 20);
+  benchmark_parsing<std::int64_t>("int64", 1 << 20);
+  std::printf("\n%-9s %10s %10s %10s %10s\n", "function", "strings", "cs19 M/s", "std M/s",
+              "speedup");
+  benchmark_sorting(1 << 20);
+  std::printf("\n%-9s %10s %10s %10s %10s\n", "function", "length", "cs19 GB/s", "base GB/s",
+              "speedup");
+  for (std::size_t length = 1 << 10; length <= 1 << 26; length <<= 4)
+    benchmark_transforms(length);
+  std::printf("\n%-9s %10s %10s %10s %10s\n", "function", "patterns", "cs19 GB/s", "matches",
+              "build ms");
+  std::string text = log_text(max_length, 7);
+  for (std::size_t count : {10, 1000, 10000, 100000})
+    benchmark_multi_search(count, text);
+  return static_cast<int>(sink & 0);
+}
@@ -1,126 +1,1843 @@
 #include "cs19_c_strings.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>  // for std::memcpy
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && \
+    !defined(CS19_C_STRINGS_NO_SIMD)
+#define CS19_C_STRINGS_X86 1
+#include <immintrin.h>
+#endif
+
 namespace cs19 {
 
+namespace {
+
+// The scanning kernels below come in word-at-a-time (SWAR), SSE2 and AVX2 versions; the widest one
+// the running CPU supports is chosen at first use. Scans of unknown length only ever load whole,
+// naturally aligned 8-, 16- or 32-byte blocks. An aligned block never straddles a page boundary, so
+// reading the rest of the block that holds the terminator can never fault, even though those bytes
+// lie past the end of the string. Bytes before the start of the string are masked off. Scans of
+// known length (the _n kernels) load unaligned blocks within the range instead, with the final
+// block overlapping the one before it.
+//
+// Those reads past the terminator are intentional and stay within the page, as in glibc, but
+// AddressSanitizer would report them, so the kernels and helpers making them are marked
+// no_sanitize("address").
+
+// A set of chars as a 256-bit bitmap
+struct CharClass {
+    std::uint64_t bits[4] = {1, 0, 0, 0};
+
+    // The chars of a C string, plus '\0' so that scans stop at the terminator
+    explicit CharClass(const char *char_list) {
+        for (; *char_list; ++char_list)
+            add(*char_list);
+    }
+
+    // Exactly the chars listed, which may include '\0', for scans of known length
+    explicit CharClass(std::string_view char_list) : bits{} {
+        for (char c : char_list)
+            add(c);
+    }
+
+    void add(char ch) {
+        auto c = static_cast<unsigned char>(ch);
+        bits[c >> 6] |= std::uint64_t{1} << (c & 63);
+    }
+
+    bool contains(char ch) const {
+        auto c = static_cast<unsigned char>(ch);
+        return bits[c >> 6] >> (c & 63) & 1;
+    }
+};
+
+inline std::size_t block_offset(const char *str, std::size_t block_size) {
+    return reinterpret_cast<std::uintptr_t>(str) & (block_size - 1);
+}
+
+constexpr std::size_t MIN_PAGE_SIZE = 4096;  // the smallest page size of any supported CPU
+
+// Whether a block of size bytes at str would reach into the next page, which may be inaccessible.
+// Comparisons of two C strings cannot align loads for both, so they check this instead.
+inline bool crosses_page(const char *str, std::size_t size) {
+    return block_offset(str, MIN_PAGE_SIZE) > MIN_PAGE_SIZE - size;
+}
+
+// Compares two chars as unsigned char, as the C library does
+inline int char_difference(char a, char b) {
+    return static_cast<unsigned char>(a) - static_cast<unsigned char>(b);
+}
+
+// Compares n chars for equality
+inline bool same_chars(const char *a, const char *b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+// The filter of a MultiSubstringSearcher is a blocked Bloom filter: a prefix hashes to one of its
+// 32-bit words, and sets or tests 3 bits of that word, found by mixing the hash further. Each half
+// of the prefix is multiplied by its own odd constant.
+constexpr std::uint32_t LOW_MULTIPLIER = 0x9E3779B1, HIGH_MULTIPLIER = 0x85EBCA77,
+                        PROBE_MULTIPLIER = 0xC2B2AE3D;
+
+// Hashes the prefix that mask keeps of the 8 chars at str
+inline std::uint32_t prefix_hash(const char *str, std::uint64_t mask) {
+    std::uint64_t word;
+    std::memcpy(&word, str, sizeof word);
+    word &= mask;
+    return static_cast<std::uint32_t>(word) * LOW_MULTIPLIER ^
+           static_cast<std::uint32_t>(word >> 32) * HIGH_MULTIPLIER;
+}
+
+// Returns the 3 bits of its word that a hashed prefix sets
+inline std::uint32_t probe_bits(std::uint32_t hash) {
+    std::uint32_t mixed = hash * PROBE_MULTIPLIER;
+    return 1U << (mixed >> 27) | 1U << (mixed >> 22 & 31) | 1U << (mixed >> 17 & 31);
+}
+
+// Checks, in order of position, the candidates that a filter on the needle's first and last chars
+// finds. Adversarial inputs can make many positions candidates that each match most of the needle,
+// so once the chars compared exceed twice the positions scanned (plus the needle's length) the
+// filter gives up, to be resumed by Two-Way. Either way the search stays linear.
+class CandidateChecker {
+ public:
+    CandidateChecker(const char *haystack, const char *needle, std::size_t n)
+        : haystack_(haystack), needle_(needle), middle_(n > 2 ? n - 2 : 0) {}
+
+    // Checks the candidate at each set bit of mask, counting from position i; returns true if the
+    // search is over, having found a match or given up
+    bool check(std::size_t i, unsigned mask) {
+        for (; mask; mask &= mask - 1) {
+            std::size_t at = i + __builtin_ctz(mask);
+            if (this->compared_ > 2 * at + this->middle_ + 64) {
+                this->resume_ = at;
+                return true;
+            }
+            const char *candidate = this->haystack_ + at + 1, *needle = this->needle_ + 1;
+            std::size_t same = 0;
+            while (same < this->middle_ && candidate[same] == needle[same])
+                ++same;
+            if (same == this->middle_) {
+                this->match_ = this->haystack_ + at;
+                return true;
+            }
+            this->compared_ += same + 1;
+        }
+        return false;
+    }
+
+    // Returns the match, if any; otherwise sets *resume to the position at which the filter gave
+    // up, leaving it unchanged if every position was checked
+    const char *result(std::size_t *resume) const {
+        if (!this->match_ && this->resume_ != NONE)
+            *resume = this->resume_;
+        return this->match_;
+    }
+
+ private:
+    static constexpr std::size_t NONE = ~std::size_t{0};
+    const char *haystack_, *needle_, *match_ = nullptr;
+    std::size_t middle_, compared_ = 0, resume_ = NONE;
+};
+
+namespace swar {
+
+constexpr std::uint64_t LOW_BITS = 0x7F7F7F7F7F7F7F7F;
+
+inline std::uint64_t load(const char *block) {
+    std::uint64_t word;
+    std::memcpy(&word, block, sizeof word);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);  // so the first char is always the lowest byte
+#endif
+    return word;
+}
+
+// Like load(), for C-string scans whose blocks may extend past the terminator within the page
+__attribute__((no_sanitize("address"))) inline std::uint64_t load_within_page(const char *block) {
+    std::uint64_t word;
+    std::memcpy(&word, block, sizeof word);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+// Returns a mask with the high bit set in exactly those bytes of word that are zero
+inline std::uint64_t zero_bytes(std::uint64_t word) {
+    return ~(((word & LOW_BITS) + LOW_BITS) | word | LOW_BITS);
+}
+
+inline std::uint64_t matching_bytes(std::uint64_t word, char c) {
+    return zero_bytes(word ^ (std::uint64_t{0x0101010101010101} * static_cast<unsigned char>(c)));
+}
+
+// Returns a pointer to the first char in str equal to c or to '\0'
+__attribute__((no_sanitize("address"))) [[maybe_unused]] const char *first_of(const char *str,
+                                                                              char c) {
+    std::size_t offset = block_offset(str, 8);
+    const char *block = str - offset;
+    std::uint64_t word = load_within_page(block);
+    std::uint64_t found = (zero_bytes(word) | matching_bytes(word, c)) & (~0ULL << 8 * offset);
+    while (!found) {
+        block += 8;
+        word = load_within_page(block);
+        found = zero_bytes(word) | matching_bytes(word, c);
+    }
+    return block + __builtin_ctzll(found) / 8;
+}
+
+// Returns a pointer to the last char in str equal to c, or nullptr, in a single pass
+__attribute__((no_sanitize("address"))) [[maybe_unused]] const char *last_of(const char *str,
+                                                                             char c) {
+    std::size_t offset = block_offset(str, 8);
+    const char *block = str - offset, *last_block = nullptr;
+    std::uint64_t skip = ~0ULL << 8 * offset, last_found = 0;
+    for (;; block += 8, skip = ~0ULL) {
+        std::uint64_t word = load_within_page(block);
+        std::uint64_t zeros = zero_bytes(word) & skip, found = matching_bytes(word, c) & skip;
+        if (zeros)
+            found &= (zeros & -zeros) - 1;  // only matches before the terminator
+        if (found) {
+            last_block = block;
+            last_found = found;
+        }
+        if (zeros)
+            break;
+    }
+    return last_block ? last_block + (63 - __builtin_clzll(last_found)) / 8 : nullptr;
+}
+
+// Returns a pointer to the first char in str in the class (possibly the terminator)
+const char *first_in(const char *str, const CharClass &chars) {
+    while (!chars.contains(*str))
+        ++str;
+    return str;
+}
+
+// Returns a pointer to the first of the length chars in str equal to c, or nullptr
+const char *first_of_n(const char *str, std::size_t length, char c) {
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        if (std::uint64_t found = matching_bytes(load(str + i), c))
+            return str + i + __builtin_ctzll(found) / 8;
+    }
+    for (; i < length; ++i)
+        if (str[i] == c)
+            return str + i;
+    return nullptr;
+}
+
+// Returns a pointer to the last of the length chars in str equal to c, or nullptr
+const char *last_of_n(const char *str, std::size_t length, char c) {
+    std::size_t i = length;
+    for (; i >= 8; i -= 8) {
+        if (std::uint64_t found = matching_bytes(load(str + i - 8), c))
+            return str + i - 8 + (63 - __builtin_clzll(found)) / 8;
+    }
+    while (i > 0)
+        if (str[--i] == c)
+            return str + i;
+    return nullptr;
+}
+
+// Returns a pointer to the first of the length chars in str in the class, or nullptr
+const char *first_in_n(const char *str, std::size_t length, const CharClass &chars) {
+    for (std::size_t i = 0; i < length; ++i)
+        if (chars.contains(str[i]))
+            return str + i;
+    return nullptr;
+}
+
+// Returns the position of the first of length chars at which a and b differ, or length
+std::size_t mismatch(const char *a, const char *b, std::size_t length) {
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        if (std::uint64_t differ = ~zero_bytes(load(a + i) ^ load(b + i)) & ~LOW_BITS)
+            return i + __builtin_ctzll(differ) / 8;
+    }
+    while (i < length && a[i] == b[i])
+        ++i;
+    return i;
+}
+
+// Returns the position of the first char (among the first limit) at which a and b differ or a
+// ends, or limit. Words that would reach into the next page are compared a char at a time.
+__attribute__((no_sanitize("address"))) std::size_t str_mismatch(const char *a, const char *b,
+                                                                 std::size_t limit) {
+    for (std::size_t i = 0; i < limit;) {
+        if (crosses_page(a + i, 8) || crosses_page(b + i, 8)) {
+            if (a[i] != b[i] || !a[i])
+                return i;
+            ++i;
+            continue;
+        }
+        std::uint64_t word = load_within_page(a + i);
+        std::uint64_t found =
+            (~zero_bytes(word ^ load_within_page(b + i)) & ~LOW_BITS) | zero_bytes(word);
+        if (found)
+            return std::min(i + __builtin_ctzll(found) / 8, limit);
+        i += 8;
+    }
+    return limit;
+}
+
+// Writes count chars from each of a and b to output, alternating between the two
+void zip(const char *a, const char *b, std::size_t count, char *output) {
+    for (std::size_t i = 0; i < count; ++i) {
+        output[2 * i] = a[i];
+        output[2 * i + 1] = b[i];
+    }
+}
+
+// Finds needle (n chars) in haystack (length chars); see CandidateChecker for the meaning of resume
+const char *find(const char *haystack, std::size_t length, const char *needle, std::size_t n,
+                 std::size_t *resume) {
+    CandidateChecker checker(haystack, needle, n);
+    for (std::size_t i = 0; i + n <= length; ++i) {
+        if (haystack[i] == needle[0] && haystack[i + n - 1] == needle[n - 1] && checker.check(i, 1))
+            break;
+    }
+    return checker.result(resume);
+}
+
+// Reverses length chars in place, swapping byte-reversed 8-byte words from both ends
+void reverse(char *str, std::size_t length) {
+    char *left = str, *right = str + length;
+    while (right - left >= 16) {
+        right -= 8;
+        std::uint64_t front, back;
+        std::memcpy(&front, left, 8);
+        std::memcpy(&back, right, 8);
+        front = __builtin_bswap64(front);
+        back = __builtin_bswap64(back);
+        std::memcpy(left, &back, 8);
+        std::memcpy(right, &front, 8);
+        left += 8;
+    }
+    while (right - left > 1)
+        std::swap(*left++, *--right);
+}
+
+constexpr std::array<char, 256> ROT13 = [] {
+    std::array<char, 256> table{};
+    for (unsigned c = 0; c < 256; ++c) {
+        unsigned lower = c | 0x20;
+        bool alpha = lower >= 'a' && lower <= 'z';
+        table[c] = static_cast<char>(!alpha ? c : lower <= 'm' ? c + 13 : c - 13);
+    }
+    return table;
+}();
+
+// Applies ROT13 to length chars in place, by table lookup
+void rot13(char *str, std::size_t length) {
+    for (std::size_t i = 0; i < length; ++i)
+        str[i] = ROT13[static_cast<unsigned char>(str[i])];
+}
+
+// Returns the number of decimal digits at the start of the 8 chars in word
+inline unsigned leading_digits(std::uint64_t word) {
+    // Digits are exactly the bytes whose high nibble is 3, both as they are and after adding 6.
+    // Adding 6 can carry out of a byte >= 0xFA, but only into later bytes, which do not matter.
+    std::uint64_t not_digits = ((word & 0xF0F0F0F0F0F0F0F0) ^ 0x3030303030303030) |
+                               (((word + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) ^
+                                0x3030303030303030);
+    return not_digits ? __builtin_ctzll(not_digits) / 8 : 8;
+}
+
+// Returns the value of the first count (1 to 8) decimal digits of the chars in word, combining
+// pairs of digits, then pairs of pairs, then the two halves, with three multiplications in all
+inline std::uint64_t digits_value(std::uint64_t word, unsigned count) {
+    word = (word - 0x3030303030303030) << (8 * (8 - count));  // shifts in leading zero digits
+    word = word * 10 + (word >> 8);
+    return ((word & 0x000000FF000000FF) * (100 + (1000000ULL << 32)) +
+            ((word >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32))) >> 32;
+}
+
+// Returns a mask of those of the 32 positions from str whose prefix passes the filter of a
+// MultiSubstringSearcher, with its word numbers in the top 32 - shift bits of hashes; reads 40
+// chars
+[[maybe_unused]] std::uint32_t prefix_candidates(const char *str, const std::uint32_t *filter,
+                                                 std::uint64_t mask, unsigned shift) {
+    std::uint32_t candidates = 0;
+    for (unsigned k = 0; k < 32; ++k) {
+        std::uint32_t hash = prefix_hash(str + k, mask), bits = probe_bits(hash);
+        candidates |= static_cast<std::uint32_t>((filter[hash >> shift] & bits) == bits) << k;
+    }
+    return candidates;
+}
+
+}  // namespace swar
+
+constexpr std::uint64_t POWERS_OF_10[] = {1,      10,      100,      1000,     10000,
+                                          100000, 1000000, 10000000, 100000000};
+
+// Accumulates the decimal digits from p up to last onto value, up to eight at a time, setting
+// overflow if value exceeds 64 bits (in which case it wraps around); returns the end of the digits
+inline const char *accumulate_digits(const char *p, const char *last, std::uint64_t &value,
+                                     bool &overflow) {
+    while (last - p >= 8) {
+        std::uint64_t word = swar::load(p);
+        unsigned count = swar::leading_digits(word);
+        if (count == 0)
+            return p;
+        overflow |= __builtin_mul_overflow(value, POWERS_OF_10[count], &value);
+        overflow |= __builtin_add_overflow(value, swar::digits_value(word, count), &value);
+        p += count;
+        if (count < 8)
+            return p;
+    }
+    for (; p != last && static_cast<unsigned char>(*p - '0') < 10; ++p) {
+        overflow |= __builtin_mul_overflow(value, 10, &value);
+        overflow |= __builtin_add_overflow(value, *p - '0', &value);
+    }
+    return p;
+}
+
+// The body of from_chars(), inlined into parse_integers()
+template <typename Integer>
+inline std::from_chars_result parse_decimal(const char *first, const char *last, Integer &value) {
+    const char *p = first;
+    bool negative = std::is_signed_v<Integer> && p != last && *p == '-';
+    p += negative;
+    std::uint64_t magnitude = 0;
+    bool overflow = false;
+    const char *end = accumulate_digits(p, last, magnitude, overflow);
+    if (end == p)
+        return {first, std::errc::invalid_argument};
+    std::uint64_t limit = std::numeric_limits<Integer>::max();
+    if (overflow || magnitude > limit + negative)
+        return {end, std::errc::result_out_of_range};
+    // Negate as magnitude - 1 first, since the magnitude of the minimum value is not representable
+    value = negative && magnitude ? -static_cast<Integer>(magnitude - 1) - 1
+                                  : static_cast<Integer>(magnitude);
+    return {end, std::errc()};
+}
+
+#ifdef CS19_C_STRINGS_X86
+
+namespace sse2 {
+
+// Returns a mask of the chars in an aligned block that are '\0' or equal to the target char
+__attribute__((no_sanitize("address"))) inline unsigned zero_or_match_mask(const char *block,
+                                                                        __m128i target) {
+    __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i *>(block));
+    return static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_setzero_si128()), _mm_cmpeq_epi8(bytes, target))));
+}
+
+__attribute__((no_sanitize("address"))) const char *first_of(const char *str, char c) {
+    std::size_t offset = block_offset(str, 16);
+    const char *block = str - offset;
+    const __m128i target = _mm_set1_epi8(c);
+    unsigned mask = zero_or_match_mask(block, target) & (~0U << offset);
+    while (!mask) {
+        block += 16;
+        mask = zero_or_match_mask(block, target);
+    }
+    return block + __builtin_ctz(mask);
+}
+
+__attribute__((no_sanitize("address"))) const char *last_of(const char *str, char c) {
+    std::size_t offset = block_offset(str, 16);
+    const char *block = str - offset, *last_block = nullptr;
+    const __m128i zero = _mm_setzero_si128(), target = _mm_set1_epi8(c);
+    unsigned skip = ~0U << offset, last_found = 0;
+    for (;; block += 16, skip = ~0U) {
+        __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i *>(block));
+        unsigned zeros = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)) & skip;
+        unsigned found = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, target)) & skip;
+        if (zeros)
+            found &= (zeros & -zeros) - 1;
+        if (found) {
+            last_block = block;
+            last_found = found;
+        }
+        if (zeros)
+            break;
+    }
+    return last_block ? last_block + (31 - __builtin_clz(last_found)) : nullptr;
+}
+
+inline unsigned matching_mask(const char *at, __m128i target) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(at));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, target));
+}
+
+const char *first_of_n(const char *str, std::size_t length, char c) {
+    if (length < 16)
+        return swar::first_of_n(str, length, c);
+    const __m128i target = _mm_set1_epi8(c);
+    std::size_t i = 0;
+    for (; i + 16 < length; i += 16) {
+        if (unsigned mask = matching_mask(str + i, target))
+            return str + i + __builtin_ctz(mask);
+    }
+    i = length - 16;
+    unsigned mask = matching_mask(str + i, target);
+    return mask ? str + i + __builtin_ctz(mask) : nullptr;
+}
+
+const char *last_of_n(const char *str, std::size_t length, char c) {
+    if (length < 16)
+        return swar::last_of_n(str, length, c);
+    const __m128i target = _mm_set1_epi8(c);
+    std::size_t i = length;
+    for (; i > 16; i -= 16) {
+        if (unsigned mask = matching_mask(str + i - 16, target))
+            return str + i - 16 + (31 - __builtin_clz(mask));
+    }
+    unsigned mask = matching_mask(str, target);
+    return mask ? str + (31 - __builtin_clz(mask)) : nullptr;
+}
+
+inline unsigned mismatch_mask(const char *a, const char *b) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xFFFF;
+}
+
+std::size_t mismatch(const char *a, const char *b, std::size_t length) {
+    if (length < 16)
+        return swar::mismatch(a, b, length);
+    std::size_t i = 0;
+    for (; i + 16 < length; i += 16) {
+        if (unsigned differ = mismatch_mask(a + i, b + i))
+            return i + __builtin_ctz(differ);
+    }
+    i = length - 16;
+    unsigned differ = mismatch_mask(a + i, b + i);
+    return differ ? i + __builtin_ctz(differ) : length;
+}
+
+// A byte of min(x, x == y) is zero exactly where x is '\0' or differs from y. Blocks that would
+// reach into the next page are left to the SWAR kernel.
+__attribute__((no_sanitize("address"))) std::size_t str_mismatch(const char *a, const char *b,
+                                                                 std::size_t limit) {
+    const __m128i zero = _mm_setzero_si128();
+    for (std::size_t i = 0; i < limit; i += 16) {
+        if (crosses_page(a + i, 16) || crosses_page(b + i, 16)) {
+            std::size_t count = std::min<std::size_t>(limit - i, 16);
+            std::size_t at = swar::str_mismatch(a + i, b + i, count);
+            if (at < count)
+                return i + at;
+            continue;
+        }
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        unsigned found = _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_cmpeq_epi8(x, y)), zero));
+        if (found)
+            return std::min(i + __builtin_ctz(found), limit);
+    }
+    return limit;
+}
+
+void zip(const char *a, const char *b, std::size_t count, char *output) {
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        auto *at = reinterpret_cast<__m128i *>(output + 2 * i);
+        _mm_storeu_si128(at, _mm_unpacklo_epi8(left, right));
+        _mm_storeu_si128(at + 1, _mm_unpackhi_epi8(left, right));
+    }
+    swar::zip(a + i, b + i, count - i, output + 2 * i);
+}
+
+// Checks 16 starting positions at a time; the final block is aligned to the last position,
+// overlapping blocks already checked, so no load reaches past the end of haystack.
+const char *find(const char *haystack, std::size_t length, const char *needle, std::size_t n,
+                 std::size_t *resume) {
+    if (length < n + 15)
+        return swar::find(haystack, length, needle, n, resume);
+    std::size_t positions = length - n + 1;
+    const __m128i first = _mm_set1_epi8(needle[0]), last = _mm_set1_epi8(needle[n - 1]);
+    CandidateChecker checker(haystack, needle, n);
+    auto candidates = [&](std::size_t i) {
+        __m128i starts = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        __m128i ends = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + n - 1));
+        return static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(starts, first), _mm_cmpeq_epi8(ends, last))));
+    };
+    std::size_t i = 0;
+    for (; i + 16 <= positions; i += 16) {
+        if (checker.check(i, candidates(i)))
+            return checker.result(resume);
+    }
+    if (i < positions) {
+        std::size_t end = positions - 16;
+        checker.check(end, candidates(end) & (~0U << (i - end)));
+    }
+    return checker.result(resume);
+}
+
+inline __m128i reversed(__m128i bytes) {
+    bytes = _mm_shuffle_epi32(bytes, _MM_SHUFFLE(0, 1, 2, 3));
+    bytes = _mm_shufflelo_epi16(bytes, _MM_SHUFFLE(2, 3, 0, 1));
+    bytes = _mm_shufflehi_epi16(bytes, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(bytes, 8), _mm_srli_epi16(bytes, 8));
+}
+
+void reverse(char *str, std::size_t length) {
+    char *left = str, *right = str + length;
+    for (; right - left >= 32; left += 16) {
+        right -= 16;
+        __m128i front = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left));
+        __m128i back = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(left), reversed(back));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(right), reversed(front));
+    }
+    swar::reverse(left, right - left);
+}
+
+// ROT13 without branches: a letter's offset from 'a' (once lowercased) selects +13 or -13, and
+// any other char gets 0
+void rot13(char *str, std::size_t length) {
+    const __m128i case_bit = _mm_set1_epi8(0x20), a = _mm_set1_epi8('a');
+    const __m128i last = _mm_set1_epi8(25), middle = _mm_set1_epi8(12);
+    const __m128i forward = _mm_set1_epi8(13), back = _mm_set1_epi8(-13);
+    std::size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        auto *at = reinterpret_cast<__m128i *>(str + i);
+        __m128i bytes = _mm_loadu_si128(at);
+        __m128i offset = _mm_sub_epi8(_mm_or_si128(bytes, case_bit), a);
+        __m128i letter = _mm_cmpeq_epi8(_mm_min_epu8(offset, last), offset);
+        __m128i first_half = _mm_cmpeq_epi8(_mm_min_epu8(offset, middle), offset);
+        __m128i shift = _mm_or_si128(_mm_and_si128(first_half, forward),
+                                     _mm_andnot_si128(first_half, back));
+        _mm_storeu_si128(at, _mm_add_epi8(bytes, _mm_and_si128(letter, shift)));
+    }
+    swar::rot13(str + i, length - i);
+}
+
+}  // namespace sse2
+
+namespace avx2 {
+
+// A byte is zero or equal to c exactly when min(byte ^ c, byte) is zero
+__attribute__((target("avx2"), no_sanitize("address"))) inline __m256i zero_or_match(
+    const char *block, __m256i target) {
+    __m256i bytes = _mm256_load_si256(reinterpret_cast<const __m256i *>(block));
+    return _mm256_min_epu8(_mm256_xor_si256(bytes, target), bytes);
+}
+
+__attribute__((target("avx2"))) inline unsigned zero_mask(__m256i bytes) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_setzero_si256()));
+}
+
+// Scans single blocks up to a 128-byte boundary, then four blocks at a time; 128 divides the page
+// size, so the four blocks share a page.
+__attribute__((target("avx2"), no_sanitize("address"))) const char *first_of(const char *str,
+                                                                              char c) {
+    std::size_t offset = block_offset(str, 32);
+    const char *block = str - offset;
+    const __m256i target = _mm256_set1_epi8(c);
+    unsigned mask = zero_mask(zero_or_match(block, target)) & (~0U << offset);
+    while (!mask && block_offset(block + 32, 128)) {
+        block += 32;
+        mask = zero_mask(zero_or_match(block, target));
+    }
+    if (mask)
+        return block + __builtin_ctz(mask);
+    for (block += 32;; block += 128) {
+        __m256i a = zero_or_match(block, target), b = zero_or_match(block + 32, target);
+        __m256i c2 = zero_or_match(block + 64, target), d = zero_or_match(block + 96, target);
+        if (zero_mask(_mm256_min_epu8(_mm256_min_epu8(a, b), _mm256_min_epu8(c2, d)))) {
+            std::uint64_t low = zero_mask(a) | std::uint64_t{zero_mask(b)} << 32;
+            if (low)
+                return block + __builtin_ctzll(low);
+            std::uint64_t high = zero_mask(c2) | std::uint64_t{zero_mask(d)} << 32;
+            return block + 64 + __builtin_ctzll(high);
+        }
+    }
+}
+
+__attribute__((target("avx2"), no_sanitize("address"))) const char *last_of(const char *str,
+                                                                             char c) {
+    std::size_t offset = block_offset(str, 32);
+    const char *block = str - offset, *last_block = nullptr;
+    const __m256i zero = _mm256_setzero_si256(), target = _mm256_set1_epi8(c);
+    unsigned skip = ~0U << offset, last_found = 0;
+    for (;; block += 32, skip = ~0U) {
+        __m256i bytes = _mm256_load_si256(reinterpret_cast<const __m256i *>(block));
+        unsigned zeros = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, zero)) & skip;
+        unsigned found = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, target)) & skip;
+        if (zeros)
+            found &= (zeros & -zeros) - 1;
+        if (found) {
+            last_block = block;
+            last_found = found;
+        }
+        if (zeros)
+            break;
+    }
+    return last_block ? last_block + (31 - __builtin_clz(last_found)) : nullptr;
+}
+
+// Tests all 32 chars of a block against the bitmap at once: the low nibble of each char selects
+// a byte of one of two 16-byte tables (by whether the high nibble is below 8), and the high nibble
+// selects a bit of that byte.
+class ClassMatcher {
+ public:
+    __attribute__((target("avx2"))) explicit ClassMatcher(const CharClass &chars) {
+        alignas(16) std::uint8_t low_rows[16] = {}, high_rows[16] = {};
+        for (unsigned word = 0; word < 4; ++word) {
+            for (std::uint64_t bits = chars.bits[word]; bits; bits &= bits - 1) {
+                unsigned c = 64 * word + __builtin_ctzll(bits);
+                (c < 128 ? low_rows : high_rows)[c & 15] |= 1 << (c >> 4 & 7);
+            }
+        }
+        this->low_table_ = _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i *>(low_rows)));
+        this->high_table_ = _mm256_broadcastsi128_si256(
+            _mm_load_si128(reinterpret_cast<const __m128i *>(high_rows)));
+    }
+
+    // Returns a mask with a bit set for each of the 32 chars in bytes that is in the class
+    __attribute__((target("avx2"))) unsigned operator()(__m256i bytes) const {
+        const __m256i bit_table = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16,
+                                                   32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1,
+                                                   2, 4, 8, 16, 32, 64, -128);
+        const __m256i nibble = _mm256_set1_epi8(0x0F), seven = _mm256_set1_epi8(7);
+        __m256i low = _mm256_and_si256(bytes, nibble);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+        __m256i rows = _mm256_blendv_epi8(_mm256_shuffle_epi8(this->low_table_, low),
+                                          _mm256_shuffle_epi8(this->high_table_, low),
+                                          _mm256_cmpgt_epi8(high, seven));
+        __m256i bits = _mm256_shuffle_epi8(bit_table, high);
+        return static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(rows, bits), bits)));
+    }
+
+ private:
+    __m256i low_table_, high_table_;
+};
+
+__attribute__((target("avx2"))) inline __m256i load(const char *at) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at));
+}
+
+__attribute__((target("avx2"), no_sanitize("address"))) const char *first_in(
+    const char *str, const CharClass &chars) {
+    const ClassMatcher matcher(chars);
+    std::size_t offset = block_offset(str, 32);
+    const char *block = str - offset;
+    unsigned mask = matcher(_mm256_load_si256(reinterpret_cast<const __m256i *>(block))) &
+                    (~0U << offset);
+    while (!mask) {
+        block += 32;
+        mask = matcher(_mm256_load_si256(reinterpret_cast<const __m256i *>(block)));
+    }
+    return block + __builtin_ctz(mask);
+}
+
+__attribute__((target("avx2"))) const char *first_in_n(const char *str, std::size_t length,
+                                                       const CharClass &chars) {
+    if (length < 32)
+        return swar::first_in_n(str, length, chars);
+    const ClassMatcher matcher(chars);
+    std::size_t i = 0;
+    for (; i + 32 < length; i += 32) {
+        if (unsigned mask = matcher(load(str + i)))
+            return str + i + __builtin_ctz(mask);
+    }
+    i = length - 32;
+    unsigned mask = matcher(load(str + i));
+    return mask ? str + i + __builtin_ctz(mask) : nullptr;
+}
+
+__attribute__((target("avx2"))) inline unsigned matching_mask(const char *at, __m256i target) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(load(at), target));
+}
+
+__attribute__((target("avx2"))) const char *first_of_n(const char *str, std::size_t length,
+                                                       char c) {
+    if (length < 32)
+        return swar::first_of_n(str, length, c);
+    const __m256i target = _mm256_set1_epi8(c);
+    std::size_t i = 0;
+    if (length > 160) {  // the first block, then aligned blocks, which never split cache lines
+        if (unsigned mask = matching_mask(str, target))
+            return str + __builtin_ctz(mask);
+        i = 32 - block_offset(str, 32);
+    }
+    for (; i + 128 < length; i += 128) {
+        __m256i a = _mm256_cmpeq_epi8(load(str + i), target);
+        __m256i b = _mm256_cmpeq_epi8(load(str + i + 32), target);
+        __m256i c2 = _mm256_cmpeq_epi8(load(str + i + 64), target);
+        __m256i d = _mm256_cmpeq_epi8(load(str + i + 96), target);
+        if (!_mm256_testz_si256(_mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c2, d)),
+                                _mm256_set1_epi8(-1)))
+            break;
+    }
+    for (; i + 32 < length; i += 32) {
+        if (unsigned mask = matching_mask(str + i, target))
+            return str + i + __builtin_ctz(mask);
+    }
+    i = length - 32;
+    unsigned mask = matching_mask(str + i, target);
+    return mask ? str + i + __builtin_ctz(mask) : nullptr;
+}
+
+__attribute__((target("avx2"))) const char *last_of_n(const char *str, std::size_t length,
+                                                      char c) {
+    if (length < 32)
+        return swar::last_of_n(str, length, c);
+    const __m256i target = _mm256_set1_epi8(c);
+    std::size_t i = length;
+    if (length > 160) {
+        if (unsigned mask = matching_mask(str + length - 32, target))
+            return str + length - 32 + (31 - __builtin_clz(mask));
+        i -= block_offset(str + length, 32);
+    }
+    for (; i > 128; i -= 128) {
+        __m256i a = _mm256_cmpeq_epi8(load(str + i - 32), target);
+        __m256i b = _mm256_cmpeq_epi8(load(str + i - 64), target);
+        __m256i c2 = _mm256_cmpeq_epi8(load(str + i - 96), target);
+        __m256i d = _mm256_cmpeq_epi8(load(str + i - 128), target);
+        if (!_mm256_testz_si256(_mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c2, d)),
+                                _mm256_set1_epi8(-1)))
+            break;
+    }
+    for (; i > 32; i -= 32) {
+        if (unsigned mask = matching_mask(str + i - 32, target))
+            return str + i - 32 + (31 - __builtin_clz(mask));
+    }
+    unsigned mask = matching_mask(str, target);
+    return mask ? str + (31 - __builtin_clz(mask)) : nullptr;
+}
+
+__attribute__((target("avx2"))) inline unsigned mismatch_mask(const char *a, const char *b) {
+    return ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(load(a), load(b))));
+}
+
+// Returns a mask of the chars in the 32 at a that are '\0' or differ from those at b
+__attribute__((target("avx2"), no_sanitize("address"))) inline __m256i end_or_mismatch(
+    const char *a, const char *b) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_cmpeq_epi8(x, y)),
+                             _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) std::size_t mismatch(const char *a, const char *b,
+                                                     std::size_t length) {
+    if (length < 32)
+        return swar::mismatch(a, b, length);
+    std::size_t i = 0;
+    if (length > 96) {  // the first block, then blocks of a that are aligned
+        if (unsigned differ = mismatch_mask(a, b))
+            return __builtin_ctz(differ);
+        i = 32 - block_offset(a, 32);
+    }
+    for (; i + 64 < length; i += 64) {
+        __m256i low = _mm256_cmpeq_epi8(load(a + i), load(b + i));
+        __m256i high = _mm256_cmpeq_epi8(load(a + i + 32), load(b + i + 32));
+        if (!_mm256_testc_si256(_mm256_and_si256(low, high), _mm256_set1_epi8(-1)))
+            break;
+    }
+    for (; i + 32 < length; i += 32) {
+        if (unsigned differ = mismatch_mask(a + i, b + i))
+            return i + __builtin_ctz(differ);
+    }
+    i = length - 32;
+    unsigned differ = mismatch_mask(a + i, b + i);
+    return differ ? i + __builtin_ctz(differ) : length;
+}
+
+// Compares pairs of blocks up to the first page boundary of either string, then crosses it with
+// the SWAR kernel. After the first block, the blocks of a are aligned, so half the loads never
+// split a cache line.
+__attribute__((target("avx2"), no_sanitize("address"))) std::size_t str_mismatch(
+    const char *a, const char *b, std::size_t limit) {
+    std::size_t i = 0;
+    if (limit && !crosses_page(a, 32) && !crosses_page(b, 32)) {
+        if (unsigned found = _mm256_movemask_epi8(end_or_mismatch(a, b)))
+            return std::min<std::size_t>(__builtin_ctz(found), limit);
+        i = 32 - block_offset(a, 32);
+    }
+    while (i < limit) {
+        std::size_t room = MIN_PAGE_SIZE - std::max(block_offset(a + i, MIN_PAGE_SIZE),
+                                                    block_offset(b + i, MIN_PAGE_SIZE));
+        if (room < 32) {
+            std::size_t count = std::min<std::size_t>(limit - i, 32);
+            std::size_t at = swar::str_mismatch(a + i, b + i, count);
+            if (at < count)
+                return i + at;
+            i += count;
+            continue;
+        }
+        std::size_t stop = i + room;
+        for (; i + 64 <= stop && i < limit; i += 64) {
+            __m256i low = end_or_mismatch(a + i, b + i);
+            __m256i high = end_or_mismatch(a + i + 32, b + i + 32);
+            if (!_mm256_testz_si256(_mm256_or_si256(low, high), _mm256_set1_epi8(-1))) {
+                std::uint64_t found = static_cast<unsigned>(_mm256_movemask_epi8(low)) |
+                                      std::uint64_t{static_cast<unsigned>(
+                                          _mm256_movemask_epi8(high))} << 32;
+                return std::min(i + __builtin_ctzll(found), limit);
+            }
+        }
+        for (; i + 32 <= stop && i < limit; i += 32) {
+            if (unsigned found = _mm256_movemask_epi8(end_or_mismatch(a + i, b + i)))
+                return std::min(i + __builtin_ctz(found), limit);
+        }
+    }
+    return limit;
+}
+
+// Unpacking interleaves within 128-bit lanes, so the lanes of the two results are then regrouped
+__attribute__((target("avx2"))) void zip(const char *a, const char *b, std::size_t count,
+                                         char *output) {
+    std::size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i left = load(a + i), right = load(b + i);
+        __m256i low = _mm256_unpacklo_epi8(left, right), high = _mm256_unpackhi_epi8(left, right);
+        auto *at = reinterpret_cast<__m256i *>(output + 2 * i);
+        _mm256_storeu_si256(at, _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256(at + 1, _mm256_permute2x128_si256(low, high, 0x31));
+    }
+    swar::zip(a + i, b + i, count - i, output + 2 * i);
+}
+
+__attribute__((target("avx2"))) const char *find(const char *haystack, std::size_t length,
+                                                 const char *needle, std::size_t n,
+                                                 std::size_t *resume) {
+    if (length < n + 31)
+        return swar::find(haystack, length, needle, n, resume);
+    std::size_t positions = length - n + 1;
+    const __m256i first = _mm256_set1_epi8(needle[0]), last = _mm256_set1_epi8(needle[n - 1]);
+    CandidateChecker checker(haystack, needle, n);
+    auto candidates = [&](std::size_t i) __attribute__((target("avx2"))) {
+        __m256i starts = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        __m256i ends = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + n - 1));
+        return static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(starts, first), _mm256_cmpeq_epi8(ends, last))));
+    };
+    std::size_t i = 0;
+    for (; i + 32 <= positions; i += 32) {
+        if (checker.check(i, candidates(i)))
+            return checker.result(resume);
+    }
+    if (i < positions) {
+        std::size_t end = positions - 32;
+        checker.check(end, candidates(end) & (~0U << (i - end)));
+    }
+    return checker.result(resume);
+}
+
+__attribute__((target("avx2"))) void reverse(char *str, std::size_t length) {
+    const __m256i within_lanes = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2,
+                                                  1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4,
+                                                  3, 2, 1, 0);
+    auto reversed = [&](__m256i bytes) __attribute__((target("avx2"))) {
+        return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(bytes, within_lanes), 0x4E);
+    };
+    char *left = str, *right = str + length;
+    for (; right - left >= 64; left += 32) {
+        right -= 32;
+        __m256i front = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(left));
+        __m256i back = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(right));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(left), reversed(back));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(right), reversed(front));
+    }
+    swar::reverse(left, right - left);
+}
+
+__attribute__((target("avx2"))) void rot13(char *str, std::size_t length) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20), a = _mm256_set1_epi8('a');
+    const __m256i last = _mm256_set1_epi8(25), middle = _mm256_set1_epi8(12);
+    const __m256i forward = _mm256_set1_epi8(13), back = _mm256_set1_epi8(-13);
+    std::size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        auto *at = reinterpret_cast<__m256i *>(str + i);
+        __m256i bytes = _mm256_loadu_si256(at);
+        __m256i offset = _mm256_sub_epi8(_mm256_or_si256(bytes, case_bit), a);
+        __m256i letter = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, last), offset);
+        __m256i first_half = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, middle), offset);
+        __m256i shift = _mm256_blendv_epi8(back, forward, first_half);
+        _mm256_storeu_si256(at, _mm256_add_epi8(bytes, _mm256_and_si256(letter, shift)));
+    }
+    swar::rot13(str + i, length - i);
+}
+
+// Returns 1 << (the 5 bits of mixed from bit low up) in each lane
+__attribute__((target("avx2"))) inline __m256i probe_bit(__m256i mixed, int low) {
+    __m256i bit = _mm256_and_si256(_mm256_srli_epi32(mixed, low), _mm256_set1_epi32(31));
+    return _mm256_sllv_epi32(_mm256_set1_epi32(1), bit);
+}
+
+// Hashes 8 positions at a time: shuffles spread the first and last 4 of the 8 chars at each
+// position into 32-bit lanes, and a gather fetches the word of the filter for each
+__attribute__((target("avx2"))) std::uint32_t prefix_candidates(const char *str,
+                                                                const std::uint32_t *filter,
+                                                                std::uint64_t mask,
+                                                                unsigned shift) {
+    const __m256i low_spread = _mm256_setr_epi8(0, 1, 2, 3, 1, 2, 3, 4, 2, 3, 4, 5, 3, 4, 5, 6, 4,
+                                                5, 6, 7, 5, 6, 7, 8, 6, 7, 8, 9, 7, 8, 9, 10);
+    const __m256i high_spread = _mm256_add_epi8(low_spread, _mm256_set1_epi8(4));
+    const __m256i low_mask = _mm256_set1_epi32(static_cast<int>(mask));
+    const __m256i high_mask = _mm256_set1_epi32(static_cast<int>(mask >> 32));
+    const __m256i low_multiplier = _mm256_set1_epi32(static_cast<int>(LOW_MULTIPLIER));
+    const __m256i high_multiplier = _mm256_set1_epi32(static_cast<int>(HIGH_MULTIPLIER));
+    const __m256i probe_multiplier = _mm256_set1_epi32(static_cast<int>(PROBE_MULTIPLIER));
+    const __m128i count = _mm_cvtsi32_si128(static_cast<int>(shift));
+    const auto *words = reinterpret_cast<const int *>(filter);
+    std::uint32_t candidates = 0;
+    for (unsigned k = 0; k < 32; k += 8) {
+        __m256i chars = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + k)));
+        __m256i low = _mm256_and_si256(_mm256_shuffle_epi8(chars, low_spread), low_mask);
+        __m256i high = _mm256_and_si256(_mm256_shuffle_epi8(chars, high_spread), high_mask);
+        __m256i hashes = _mm256_xor_si256(_mm256_mullo_epi32(low, low_multiplier),
+                                          _mm256_mullo_epi32(high, high_multiplier));
+        __m256i found = _mm256_i32gather_epi32(words, _mm256_srl_epi32(hashes, count), 4);
+        __m256i mixed = _mm256_mullo_epi32(hashes, probe_multiplier);
+        __m256i bits = _mm256_or_si256(_mm256_or_si256(probe_bit(mixed, 27), probe_bit(mixed, 22)),
+                                       probe_bit(mixed, 17));
+        __m256i passed = _mm256_cmpeq_epi32(_mm256_and_si256(found, bits), bits);
+        candidates |= static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(passed)))
+                      << k;
+    }
+    return candidates;
+}
+
+}  // namespace avx2
+
+#endif  // CS19_C_STRINGS_X86
+
+struct Kernels {
+    const char *(*first_of)(const char *str, char c);
+    const char *(*last_of)(const char *str, char c);
+    const char *(*first_in)(const char *str, const CharClass &chars);
+    const char *(*first_of_n)(const char *str, std::size_t length, char c);
+    const char *(*last_of_n)(const char *str, std::size_t length, char c);
+    const char *(*first_in_n)(const char *str, std::size_t length, const CharClass &chars);
+    void (*zip)(const char *a, const char *b, std::size_t count, char *output);
+    std::size_t (*mismatch)(const char *a, const char *b, std::size_t length);
+    std::size_t (*str_mismatch)(const char *a, const char *b, std::size_t limit);
+    const char *(*find)(const char *haystack, std::size_t length, const char *needle,
+                        std::size_t n, std::size_t *resume);
+    void (*reverse)(char *str, std::size_t length);
+    void (*rot13)(char *str, std::size_t length);
+    std::uint32_t (*prefix_candidates)(const char *str, const std::uint32_t *filter,
+                                       std::uint64_t mask, unsigned shift);
+};
+
+constexpr std::size_t LONG_NEEDLE = 33;  // the shortest needle for which Two-Way takes shifts
+
+// Hashes the two chars ending at p, for Horspool shifts on pairs of chars: a single char of a long
+// needle tends to recur near its end, allowing only short shifts, whereas most pairs do not
+inline std::uint8_t bigram_hash(const char *p) {
+    return static_cast<std::uint8_t>(static_cast<unsigned char>(p[0]) -
+                                     (static_cast<unsigned char>(p[-1]) << 3));
+}
+
+// Computes the critical factorization of a needle of n >= 1 chars, by the maximal suffixes under
+// the two opposite orderings of chars (Crochemore & Perrin); returns where it splits the needle and
+// sets period to the period of the right part
+std::size_t critical_factorization(const char *needle, std::size_t n, std::size_t &period) {
+    if (n < 3) {
+        period = 1;
+        return n - 1;
+    }
+    auto at = [needle](std::size_t i) { return static_cast<unsigned char>(needle[i]); };
+    std::size_t suffixes[2], periods[2];
+    for (int reversed = 0; reversed < 2; ++reversed) {
+        std::size_t max_suffix = ~std::size_t{0}, j = 0, k = 1, p = 1;  // max_suffix + 1 wraps to 0
+        while (j + k < n) {
+            unsigned char a = at(j + k), b = at(max_suffix + k);
+            if (reversed ? b < a : a < b) {
+                j += k;
+                k = 1;
+                p = j - max_suffix;
+            } else if (a == b) {
+                if (k != p) {
+                    ++k;
+                } else {
+                    j += p;
+                    k = 1;
+                }
+            } else {
+                max_suffix = j++;
+                k = p = 1;
+            }
+        }
+        suffixes[reversed] = max_suffix + 1;
+        periods[reversed] = p;
+    }
+    int later = suffixes[1] >= suffixes[0];
+    period = periods[later];
+    return suffixes[later];
+}
+
+const Kernels &kernels() {
+    static const Kernels selected = [] {
+#ifdef CS19_C_STRINGS_X86
+        // SSE2 lacks the byte shuffle that first_in() needs, so it keeps the bitmap loop
+        if (__builtin_cpu_supports("avx2"))
+            return Kernels{avx2::first_of, avx2::last_of, avx2::first_in, avx2::first_of_n,
+                           avx2::last_of_n, avx2::first_in_n, avx2::zip, avx2::mismatch,
+                           avx2::str_mismatch, avx2::find, avx2::reverse, avx2::rot13,
+                           avx2::prefix_candidates};
+        return Kernels{sse2::first_of, sse2::last_of, swar::first_in, sse2::first_of_n,
+                       sse2::last_of_n, swar::first_in_n, sse2::zip, sse2::mismatch,
+                       sse2::str_mismatch, sse2::find, sse2::reverse, sse2::rot13,
+                       swar::prefix_candidates};
+#else
+        return Kernels{swar::first_of, swar::last_of, swar::first_in, swar::first_of_n,
+                       swar::last_of_n, swar::first_in_n, swar::zip, swar::mismatch,
+                       swar::str_mismatch, swar::find, swar::reverse, swar::rot13,
+                       swar::prefix_candidates};
+#endif
+    }();
+    return selected;
+}
+
+// Compares two C strings known to match in their first depth chars
+inline int compare_from(const char *str1, const char *str2, std::size_t depth) {
+    str1 += depth;
+    str2 += depth;
+    std::size_t at = kernels().str_mismatch(str1, str2, SIZE_MAX);
+    return char_difference(str1[at], str2[at]);
+}
+
+// Sorts count C strings that match in their first depth chars
+void insertion_sort(const char **strings, std::size_t count, std::size_t depth) {
+    for (std::size_t i = 1; i < count; ++i) {
+        const char *str = strings[i];
+        std::size_t j = i;
+        for (; j > 0 && compare_from(strings[j - 1], str, depth) > 0; --j)
+            strings[j] = strings[j - 1];
+        strings[j] = str;
+    }
+}
+
+constexpr std::size_t INSERTION_SORT_MAX = 16;
+
+// Three-way string quicksort of count C strings that match in their first depth chars. Each step
+// compares every string with the pivot in one batch, which also yields each string's common prefix
+// with the pivot. The strings less than the pivot all match in at least the shortest of their
+// prefixes, so they are sorted from there on, and likewise those greater; those equal are done.
+// results and prefixes are scratch space for count values.
+void string_quicksort(const char **strings, std::size_t count, std::size_t depth, int *results,
+                      std::size_t *prefixes) {
+    while (count > INSERTION_SORT_MAX) {
+        const char *a = strings[0], *b = strings[count / 2], *c = strings[count - 1];
+        if (compare_from(a, b, depth) > 0)
+            std::swap(a, b);
+        if (compare_from(b, c, depth) > 0)
+            b = compare_from(a, c, depth) > 0 ? a : c;
+        strcmp_batch(strings, count, b, depth, results, prefixes);
+
+        // [0, less) < pivot, [less, i) == pivot, [greater, count) > pivot
+        std::size_t less = 0, greater = count, less_depth = SIZE_MAX, greater_depth = SIZE_MAX;
+        auto swap = [&](std::size_t i, std::size_t j) {
+            std::swap(strings[i], strings[j]);
+            std::swap(results[i], results[j]);
+            std::swap(prefixes[i], prefixes[j]);
+        };
+        for (std::size_t i = 0; i < greater;) {
+            if (results[i] < 0) {
+                less_depth = std::min(less_depth, prefixes[i]);
+                swap(less++, i++);
+            } else if (results[i] > 0) {
+                greater_depth = std::min(greater_depth, prefixes[i]);
+                swap(i, --greater);
+            } else {
+                ++i;
+            }
+        }
+        // Recur on the smaller side and loop on the larger, bounding the depth of recursion
+        if (less < count - greater) {
+            string_quicksort(strings, less, less_depth, results, prefixes);
+            strings += greater;
+            results += greater;
+            prefixes += greater;
+            count -= greater;
+            depth = greater_depth;
+        } else {
+            string_quicksort(strings + greater, count - greater, greater_depth, results + greater,
+                             prefixes + greater);
+            count = less;
+            depth = less_depth;
+        }
+    }
+    insertion_sort(strings, count, depth);
+}
+
+// The most distinct first chars of patterns for which a MultiSubstringSearcher skips to them
+constexpr std::size_t MAX_FIRST_CHARS = 4;
+// The most transitions resolved in advance, so that the cells of a MultiSubstringSearcher's
+// shallow states, which most chars of a haystack visit, fit in a typical L2 cache
+constexpr std::size_t RESOLVED_CELLS = 1 << 16;
+// The most leading chars of patterns that a MultiSubstringSearcher hashes to filter positions
+constexpr std::size_t MAX_PREFIX_LENGTH = 8;
+// The bits of a MultiSubstringSearcher's filter per pattern, within bounds that keep it in L2 cache
+constexpr std::size_t FILTER_BITS_PER_PATTERN = 64, MIN_FILTER_BITS = 1 << 12,
+                      MAX_FILTER_BITS = 1 << 22;
+// The filter is only consulted if at most one in this many of its bits are set, so that a position
+// passes all 3 of its probes at most about one time in 64
+constexpr std::size_t MIN_FILTER_SPARSITY = 4;
+
+}  // namespace
+
 
 unsigned atoi(const char *str) {
-    int istr = 0;
-    int decimal = 1;
-    for (int i = strlen(str) - 1; i >= 0; i--) {
-        istr += decimal * (*(str + i) - 48);
-        decimal *= 10;
+    std::uint64_t value = 0;
+    bool overflow = false;
+    accumulate_digits(str, str + strlen(str), value, overflow);
+    return static_cast<unsigned>(value);
+}
+
+unsigned atoi(std::string_view str) {
+    std::uint64_t value = 0;
+    bool overflow = false;
+    accumulate_digits(str.data(), str.data() + str.size(), value, overflow);
+    return static_cast<unsigned>(value);
+}
+
+template <typename Integer>
+std::from_chars_result from_chars(const char *first, const char *last, Integer &value) {
+    return parse_decimal(first, last, value);
+}
+
+template <typename Integer>
+std::from_chars_result parse_integers(const char *first, const char *last, char delimiter,
+                                      std::vector<Integer> &values) {
+    const char *p = first;
+    while (p != last) {
+        Integer value = 0;
+        std::from_chars_result result = parse_decimal(p, last, value);
+        if (result.ec != std::errc())
+            return result;
+        values.push_back(value);
+        p = result.ptr;
+        if (p != last && *p++ != delimiter)
+            return {p - 1, std::errc::invalid_argument};
     }
-    return istr;
+    return {p, std::errc()};
 }
 
+#define CS19_INSTANTIATE_PARSERS(Integer)                                                     \
+    template std::from_chars_result from_chars(const char *, const char *, Integer &);        \
+    template std::from_chars_result parse_integers(const char *, const char *, char,          \
+                                                   std::vector<Integer> &);
+CS19_INSTANTIATE_PARSERS(int)
+CS19_INSTANTIATE_PARSERS(unsigned)
+CS19_INSTANTIATE_PARSERS(long)
+CS19_INSTANTIATE_PARSERS(unsigned long)
+CS19_INSTANTIATE_PARSERS(long long)
+CS19_INSTANTIATE_PARSERS(unsigned long long)
+#undef CS19_INSTANTIATE_PARSERS
+
 
 const char *strchr(const char *haystack, const char needle) {
-    for (; *haystack; ++haystack)
-        if (*haystack == needle)
-            return haystack;
-    return nullptr;
+    const char *found = kernels().first_of(haystack, needle);
+    return *found ? found : nullptr;
+}
+
+const char *strchr(std::string_view haystack, char needle) {
+    return kernels().first_of_n(haystack.data(), haystack.size(), needle);
 }
 
 int strcmp(const char *str1, const char *str2) {
-    int istr1 = *str1;
-    int istr2 = *str2;
-    return istr1 - istr2;
+    std::size_t at = kernels().str_mismatch(str1, str2, SIZE_MAX);
+    return char_difference(str1[at], str2[at]);
+}
+
+int strcmp(std::string_view str1, std::string_view str2) {
+    std::size_t length = std::min(str1.size(), str2.size());
+    std::size_t at = kernels().mismatch(str1.data(), str2.data(), length);
+    if (at < length)
+        return char_difference(str1[at], str2[at]);
+    return (str1.size() > length) - (str2.size() > length);
+}
+
+int strncmp(const char *str1, const char *str2, std::size_t n) {
+    std::size_t at = kernels().str_mismatch(str1, str2, n);
+    return at < n ? char_difference(str1[at], str2[at]) : 0;
+}
+
+int memcmp(const void *ptr1, const void *ptr2, std::size_t n) {
+    auto *bytes1 = static_cast<const char *>(ptr1), *bytes2 = static_cast<const char *>(ptr2);
+    std::size_t at = kernels().mismatch(bytes1, bytes2, n);
+    return at < n ? char_difference(bytes1[at], bytes2[at]) : 0;
+}
+
+void strcmp_batch(const char *const *strings, std::size_t count, const char *pivot,
+                  std::size_t depth, int *results, std::size_t *prefixes) {
+    constexpr std::size_t PREFETCH_AHEAD = 8;  // strings whose first chars are fetched in advance
+    auto str_mismatch = kernels().str_mismatch;
+    const char *rest = pivot + depth;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i + PREFETCH_AHEAD < count)
+            __builtin_prefetch(strings[i + PREFETCH_AHEAD] + depth);
+        const char *str = strings[i] + depth;
+        std::size_t at = str_mismatch(str, rest, SIZE_MAX);
+        results[i] = char_difference(str[at], rest[at]);
+        if (prefixes)
+            prefixes[i] = depth + at;
+    }
+}
+
+void sort_strings(const char **first, const char **last) {
+    std::size_t count = last - first;
+    std::vector<int> results(count);
+    std::vector<std::size_t> prefixes(count);
+    string_quicksort(first, count, 0, results.data(), prefixes.data());
 }
 
 
 std::size_t strlen(const char *str) {
-    int size = 0;
-    for (; *str; ++str)
-        size += 1;
-    return size;
+    return kernels().first_of(str, '\0') - str;
+}
+
+std::size_t strlen(std::string_view str) {
+    const char *terminator = kernels().first_of_n(str.data(), str.size(), '\0');
+    return terminator ? terminator - str.data() : str.size();
 }
 
 
 const char *strpbrk(const char *haystack, const char *char_list) {
-    for (; *haystack; ++haystack) {
-        int i = 0;
-        while (*(char_list + i)) {
-            if (*haystack == *(char_list + i)) {
-                return haystack;
-            }
-            i += 1;
-        }
-    }
-    return nullptr;
+    const char *found = kernels().first_in(haystack, CharClass(char_list));
+    return *found ? found : nullptr;
+}
+
+const char *strpbrk(std::string_view haystack, std::string_view char_list) {
+    return kernels().first_in_n(haystack.data(), haystack.size(), CharClass(char_list));
 }
 
 const char *strrchr(const char *haystack, const char needle) {
-    bool match_check = false;
-    int match_index = 0;
-    int i = 0;
-    while (*(haystack + i)) {
-        if (*(haystack + i) == needle) {
-            match_check = true;
-            match_index = i;
-        }
-        i += 1;
-    }
-    if (match_check) {
-        return haystack + match_index;
-    } else {
-        return nullptr;
-    }
+    return kernels().last_of(haystack, needle);
+}
+
+const char *strrchr(std::string_view haystack, char needle) {
+    return kernels().last_of_n(haystack.data(), haystack.size(), needle);
 }
 
 char *strrev(char *str) {
-    char *ptr = str;
-    char first;
-    char *ptr_to_last = &(str[strlen(str) - 1]);
-    while (ptr_to_last > str) {
-        first = *str;
-        *str = *ptr_to_last;
-        str++;
-        *ptr_to_last = first;
-        ptr_to_last--;
-    }
-    return ptr;
+    return strrev(str, strlen(str));
+}
+
+char *strrev(char *str, std::size_t length) {
+    kernels().reverse(str, length);
+    return str;
 }
 
 const char *strstr(const char *haystack, const char *needle) {
-    int lindex = strlen(needle) - 1;
-    for (; *haystack; haystack++) {
-        for (int i = 0; *(needle + i) && *haystack == *(needle + i); i++) {
-            if (i == lindex) {
-                return haystack;
+    std::size_t n = strlen(needle);
+    if (n == 1)
+        return strchr(haystack, *needle);
+    return strstr(std::string_view(haystack, n ? strlen(haystack) : 0),
+                  std::string_view(needle, n));
+}
+
+const char *strstr(std::string_view haystack, std::string_view needle) {
+    std::size_t length = haystack.size(), n = needle.size();
+    if (n == 0 || n > length)
+        return nullptr;
+    if (n == 1)
+        return strchr(haystack, needle[0]);
+    // Preprocess the needle only if the filter gives up
+    std::size_t resume = length;
+    const char *found = kernels().find(haystack.data(), length, needle.data(), n, &resume);
+    if (found || resume == length)
+        return found;
+    return SubstringSearcher(needle).find(haystack.data() + resume, length - resume);
+}
+
+SubstringSearcher::SubstringSearcher(const char *needle)
+    : SubstringSearcher(std::string_view(needle)) {}
+
+SubstringSearcher::SubstringSearcher(std::string_view needle) : needle_(needle) {
+    std::size_t n = this->needle_.size();
+    if (n == 0)
+        return;
+    std::size_t period;
+    this->critical_ = critical_factorization(needle.data(), n, period);
+    this->periodic_ = same_chars(needle.data(), needle.data() + period, this->critical_);
+    this->period_ = this->periodic_ ? period : std::max(this->critical_, n - this->critical_) + 1;
+    if (n >= LONG_NEEDLE) {
+        // Shifts are capped at 255, which only ever makes them smaller, hence still safe
+        this->shifts_.fill(static_cast<std::uint8_t>(std::min<std::size_t>(n - 1, 255)));
+        for (std::size_t i = 1; i < n; ++i) {
+            this->shifts_[bigram_hash(needle.data() + i)] =
+                static_cast<std::uint8_t>(std::min<std::size_t>(n - 1 - i, 255));
+        }
+    }
+}
+
+const char *SubstringSearcher::find(const char *haystack) const {
+    return this->find(haystack, strlen(haystack));
+}
+
+const char *SubstringSearcher::find(std::string_view haystack) const {
+    return this->find(haystack.data(), haystack.size());
+}
+
+const char *SubstringSearcher::find(const char *haystack, std::size_t length) const {
+    std::size_t n = this->needle_.size();
+    if (n == 0 || n > length)
+        return nullptr;
+    std::size_t resume = length;
+    const char *found = kernels().find(haystack, length, this->needle_.data(), n, &resume);
+    if (found || resume == length)
+        return found;
+    return this->two_way(haystack + resume, length - resume);
+}
+
+std::size_t SubstringSearcher::size() const {
+    return this->needle_.size();
+}
+
+// Two-Way matching: compares the right part of the needle left to right, then the left part right
+// to left. A mismatch in the right part shifts past it; a mismatch in the left part (or a match)
+// shifts by the period, and for periodic needles the prefix known to match is remembered rather
+// than compared again. Either way no haystack char is compared more than twice. Long needles first
+// take the Horspool shift for the pair of chars under the end of the needle.
+const char *SubstringSearcher::two_way(const char *haystack, std::size_t length) const {
+    const char *needle = this->needle_.data();
+    std::size_t n = this->needle_.size(), suffix = this->critical_;
+    bool horspool = n >= LONG_NEEDLE;
+    std::size_t memory = 0;  // the length of the prefix known to match
+    for (std::size_t j = 0; n <= length && j <= length - n;) {
+        if (horspool) {
+            if (std::size_t shift = this->shifts_[bigram_hash(haystack + j + n - 1)]) {
+                memory = 0;
+                j += shift;
+                continue;
             }
         }
+        std::size_t i = std::max(suffix, memory);
+        while (i < n && needle[i] == haystack[j + i])
+            ++i;
+        if (i < n) {
+            j += i - suffix + 1;
+            memory = 0;
+            continue;
+        }
+        i = suffix;
+        while (i > memory && needle[i - 1] == haystack[j + i - 1])
+            --i;
+        if (i <= memory)
+            return haystack + j;
+        j += this->period_;
+        memory = this->periodic_ ? n - this->period_ : 0;
     }
     return nullptr;
 }
 
-void strzip(const char *str1, const char *str2, char *output) {
-    for (int i = 0; *str1 || *str2; ++output) {
-        if (*str1 && i % 2 == 0) {
-            *output = *str1;
-            ++str1;
+// Builds a trie with sorted lists of children, whose nodes become the states, then resolves the
+// transitions of the shallowest states in breadth-first order: those of its fail state are already
+// known, and a state inherits those for chars on which it has no child. Deeper states, which text
+// rarely reaches, keep only their children and fall back along fail links, so the automaton stays
+// small enough for cache however many patterns there are. Lastly the transitions of each state are
+// placed in the double array at the first base where all of them fit.
+MultiSubstringSearcher::MultiSubstringSearcher(const std::vector<std::string> &patterns)
+    : duplicate_(patterns.size(), NONE), lengths_(patterns.size()) {
+    struct Node {
+        std::uint32_t child, sibling;
+        unsigned char label;
+    };
+    std::vector<Node> trie{{NONE, NONE, 0}};
+    this->pattern_.push_back(NONE);
+    bool begins[256] = {};
+    std::size_t shortest = ~std::size_t{0}, nonempty = 0;
+    for (std::uint32_t p = 0; p < patterns.size(); ++p) {
+        const std::string &pattern = patterns[p];
+        this->lengths_[p] = pattern.size();
+        this->longest_ = std::max(this->longest_, pattern.size());
+        if (pattern.empty())
+            continue;
+        shortest = std::min(shortest, pattern.size());
+        ++nonempty;
+        begins[static_cast<unsigned char>(pattern[0])] = true;
+        std::uint32_t node = 0;
+        for (char ch : pattern) {
+            auto c = static_cast<unsigned char>(ch);
+            std::uint32_t previous = NONE, next = trie[node].child;
+            for (; next != NONE && trie[next].label < c; next = trie[next].sibling)
+                previous = next;
+            if (next == NONE || trie[next].label != c) {
+                auto added = static_cast<std::uint32_t>(trie.size());
+                trie.push_back({NONE, next, c});
+                this->pattern_.push_back(NONE);
+                (previous == NONE ? trie[node].child : trie[previous].sibling) = added;
+                next = added;
+            }
+            node = next;
+        }
+        std::uint32_t *last = &this->pattern_[node];
+        while (*last != NONE)
+            last = &this->duplicate_[*last];
+        *last = p;
+    }
+    if (static_cast<std::size_t>(std::count(begins, begins + 256, true)) <= MAX_FIRST_CHARS) {
+        for (unsigned c = 0; c < 256; ++c)
+            if (begins[c])
+                this->first_chars_ += static_cast<char>(c);
+    }
+
+    // Otherwise filter positions by hashed prefixes, if they are long enough to rule out most
+    if (this->first_chars_.empty() && nonempty && shortest >= 2) {
+        this->prefix_length_ = static_cast<unsigned>(std::min(shortest, MAX_PREFIX_LENGTH));
+        char ones[MAX_PREFIX_LENGTH] = {};
+        std::memset(ones, 0xFF, this->prefix_length_);
+        std::memcpy(&this->prefix_mask_, ones, sizeof ones);
+        std::size_t bits = MIN_FILTER_BITS;
+        while (bits < MAX_FILTER_BITS && bits < FILTER_BITS_PER_PATTERN * nonempty)
+            bits *= 2;
+        this->filter_shift_ = 32 - __builtin_ctzll(bits / 32);
+        this->filter_.assign(bits / 32, 0);
+        for (const std::string &pattern : patterns) {
+            if (pattern.empty())
+                continue;
+            char prefix[MAX_PREFIX_LENGTH] = {};
+            std::memcpy(prefix, pattern.data(), this->prefix_length_);
+            std::uint32_t hash = prefix_hash(prefix, this->prefix_mask_);
+            this->filter_[hash >> this->filter_shift_] |= probe_bits(hash);
         }
-        if (*str2 && i % 2 != 0) {
-            *output = *str2;
-            ++str2;
+        std::size_t set = 0;
+        for (std::uint32_t word : this->filter_)
+            set += __builtin_popcount(word);
+        if (set * MIN_FILTER_SPARSITY > bits) {
+            this->prefix_length_ = 0;
+            std::vector<std::uint32_t>().swap(this->filter_);
         }
-        ++i;
     }
-}
 
+    // Find the fail state of each state and resolve the transitions of the shallowest, sorted by
+    // char, while they fit in RESOLVED_CELLS; the root's are all in its table instead
+    std::size_t states = trie.size(), budget = RESOLVED_CELLS;
+    using Moves = std::vector<std::pair<unsigned char, std::uint32_t>>;
+    std::vector<Moves> moves(states);
+    std::vector<std::uint32_t> fail(states, 0), depth(states, 0);
+    std::vector<bool> resolved(states, false);
+    resolved[0] = true;
+    this->output_.assign(states, NONE);
+    this->next_output_.assign(states, NONE);
+    for (std::uint32_t c = trie[0].child; c != NONE; c = trie[c].sibling)
+        this->root_[trie[c].label] = c;
+    auto transition = [&](std::uint32_t s, unsigned char c) {
+        for (; s != 0; s = fail[s]) {
+            for (const auto &[label, next] : moves[s])
+                if (label == c)
+                    return next;
+            if (resolved[s])
+                break;
+        }
+        return this->root_[c];
+    };
+    std::vector<std::uint32_t> queue{0};
+    for (std::size_t q = 0; q < queue.size(); ++q) {
+        std::uint32_t s = queue[q];
+        for (std::uint32_t c = trie[s].child; c != NONE; c = trie[c].sibling) {
+            queue.push_back(c);
+            depth[c] = depth[s] + 1;
+            fail[c] = s == 0 ? 0 : transition(fail[s], trie[c].label);
+            this->next_output_[c] = this->output_[fail[c]];
+            this->output_[c] = this->pattern_[c] != NONE ? c : this->next_output_[c];
+        }
+        if (s == 0)
+            continue;
+        const Moves &inherited = moves[fail[s]];
+        std::size_t children = 0;
+        for (std::uint32_t c = trie[s].child; c != NONE; c = trie[c].sibling)
+            ++children;
+        if (resolved[fail[s]] && inherited.size() + children <= budget) {
+            resolved[s] = true;
+            auto from = inherited.begin();
+            for (std::uint32_t c = trie[s].child; c != NONE; c = trie[c].sibling) {
+                for (; from != inherited.end() && from->first < trie[c].label; ++from)
+                    moves[s].push_back(*from);
+                if (from != inherited.end() && from->first == trie[c].label)
+                    ++from;
+                moves[s].emplace_back(trie[c].label, c);
+            }
+            moves[s].insert(moves[s].end(), from, inherited.end());
+            budget -= moves[s].size();
+        } else {
+            for (std::uint32_t c = trie[s].child; c != NONE; c = trie[c].sibling)
+                moves[s].emplace_back(trie[c].label, c);
+        }
+    }
+    // A resolved state falls back to the root's table, which the scan reaches by a fail link of 0
+    for (std::uint32_t s = 0; s < states; ++s)
+        if (resolved[s])
+            fail[s] = 0;
 
-char *str_rot13(char *str) {
-    char *ptr = str;
-    int istr;
-    for (; *str; ++str) {
-        istr = *str;
-        if ((istr >= 65 && istr <= 90) || (istr >= 97 && istr <= 122)) {
-            istr += 13;
-            if ((istr > 90 && istr < 97) || (istr > 122)) {
-                istr -= 26;
+    // Place the transitions of each state, numbering the state by its base, which is then unique.
+    // Free cells are kept in a circular doubly linked list headed by cell 0, which is never used,
+    // so bases are only tried where the first transition would fit. A free cell that many bases
+    // have been tried at is dropped from the list, so placement takes linear time.
+    constexpr std::uint8_t MAX_TRIES = 16, UNLISTED = 0xFF;
+    std::vector<std::uint32_t> id(states, 0), next_free, previous_free;
+    std::vector<std::uint8_t> tries;
+    std::vector<bool> taken(1, true);  // the bases numbering states
+    auto unlist = [&](std::uint32_t cell) {
+        next_free[previous_free[cell]] = next_free[cell];
+        previous_free[next_free[cell]] = previous_free[cell];
+        tries[cell] = UNLISTED;
+    };
+    auto grow = [&](std::size_t size) {
+        std::size_t old_size = this->cells_.size();
+        if (old_size >= size)
+            return;
+        this->cells_.resize(size, {NONE, 0});
+        taken.resize(size);
+        next_free.resize(size);
+        previous_free.resize(size);
+        tries.resize(size);
+        std::uint32_t tail = old_size ? previous_free[0] : 0;
+        for (std::size_t c = std::max<std::size_t>(old_size, 1); c < size; ++c) {
+            next_free[tail] = static_cast<std::uint32_t>(c);
+            previous_free[c] = tail;
+            tail = static_cast<std::uint32_t>(c);
+        }
+        next_free[tail] = 0;
+        previous_free[0] = tail;
+    };
+    grow(256);
+    for (std::uint32_t s : queue) {
+        if (moves[s].empty())
+            continue;
+        unsigned char low = moves[s].front().first;
+        std::size_t base;
+        for (std::uint32_t free = next_free[0];; free = next_free[free]) {
+            if (free == 0) {  // no free cell fits the transitions: add cells at the end
+                free = static_cast<std::uint32_t>(this->cells_.size());
+                grow(free + 256);
             }
-            *str = static_cast<char>(istr);
+            bool fits = free > low && !taken[free - low];
+            if (fits) {
+                base = free - low;
+                grow(base + 256);
+                for (auto move = moves[s].begin() + 1; move != moves[s].end() && fits; ++move)
+                    fits = this->cells_[base + move->first].check == NONE;
+            }
+            if (fits)
+                break;
+            if (++tries[free] == MAX_TRIES)
+                unlist(free);
+        }
+        id[s] = static_cast<std::uint32_t>(base);
+        taken[base] = true;
+        for (const auto &[label, next] : moves[s]) {
+            std::size_t t = base + label;
+            this->cells_[t] = {id[s], next};
+            if (tries[t] != UNLISTED)
+                unlist(static_cast<std::uint32_t>(t));
         }
+        Moves().swap(moves[s]);
+    }
+    // The other states are numbered by bases that no cell is checked against, and the root by 0
+    std::size_t unused = 1;
+    for (std::uint32_t s = 1; s < states; ++s) {
+        if (id[s])
+            continue;
+        while (unused < taken.size() && taken[unused])
+            ++unused;
+        grow(unused + 256);
+        id[s] = static_cast<std::uint32_t>(unused);
+        taken[unused] = true;
+    }
+
+    // Renumber everything by state number
+    for (Cell &cell : this->cells_)
+        if (cell.check != NONE)
+            cell.next = id[cell.next];
+    for (std::uint32_t &next : this->root_)
+        next = id[next];
+    auto renumber = [&](std::uint32_t s) { return s == NONE ? NONE : id[s]; };
+    this->fail_.assign(this->cells_.size(), 0);
+    std::vector<std::uint32_t> output(this->cells_.size(), NONE);
+    std::vector<std::uint32_t> next_output(this->cells_.size(), NONE);
+    std::vector<std::uint32_t> pattern(this->cells_.size(), NONE);
+    for (std::uint32_t s = 0; s < states; ++s) {
+        this->fail_[id[s]] = id[fail[s]];
+        output[id[s]] = renumber(this->output_[s]);
+        next_output[id[s]] = renumber(this->next_output_[s]);
+        pattern[id[s]] = this->pattern_[s];
+    }
+    this->output_ = std::move(output);
+    this->next_output_ = std::move(next_output);
+    this->pattern_ = std::move(pattern);
+    if (this->prefix_length_) {
+        this->depth_.assign(this->cells_.size(), 0);
+        for (std::uint32_t s = 0; s < states; ++s)
+            this->depth_[id[s]] = depth[s];
+    }
+}
+
+// Runs the automaton over haystack, calling report(pattern, offset) for each match; report returns
+// the length of haystack to which to keep scanning
+template <typename Report>
+void MultiSubstringSearcher::scan(const char *haystack, std::size_t length, Report report) const {
+    if (this->prefix_length_)
+        return this->scan_candidates(haystack, length, report);
+    const Cell *cells = this->cells_.data();
+    const std::uint32_t *fail = this->fail_.data(), *output = this->output_.data();
+    const CharClass first(std::string_view{this->first_chars_});
+    bool skip = !this->first_chars_.empty();
+    std::uint32_t s = 0;
+    for (std::size_t i = 0; i < length; ++i) {
+        if (s == 0 && skip && !first.contains(haystack[i])) {
+            const char *next = kernels().first_in_n(haystack + i, length - i, first);
+            if (!next)
+                return;
+            i = next - haystack;
+        }
+        auto c = static_cast<unsigned char>(haystack[i]);
+        while (s != 0 && cells[s + c].check != s)
+            s = fail[s];
+        s = s != 0 ? cells[s + c].next : this->root_[c];
+        if (output[s] == NONE)
+            continue;
+        for (std::uint32_t u = output[s]; u != NONE; u = this->next_output_[u]) {
+            for (std::uint32_t p = this->pattern_[u]; p != NONE; p = this->duplicate_[p])
+                length = std::min(length, report(p, i + 1 - this->lengths_[p]));
+        }
+    }
+}
+
+// Like scan(), but only at positions whose prefix passes the filter, matching patterns that begin
+// there by walking the trie: only transitions that deepen the state by one belong to it. Matches
+// are reported in order of where they begin. Positions are filtered 32 at a time.
+template <typename Report>
+void MultiSubstringSearcher::scan_candidates(const char *haystack, std::size_t length,
+                                             Report report) const {
+    const Cell *cells = this->cells_.data();
+    const std::uint32_t *depth = this->depth_.data();
+    const std::uint32_t *filter = this->filter_.data();
+    std::uint64_t mask = this->prefix_mask_;
+    unsigned shift = this->filter_shift_;
+    auto match_at = [&](std::size_t i) {
+        std::uint32_t s = 0;
+        for (std::size_t j = i; j < length; ++j) {
+            auto c = static_cast<unsigned char>(haystack[j]);
+            std::uint32_t next = s == 0                  ? this->root_[c]
+                                 : cells[s + c].check == s ? cells[s + c].next
+                                                           : 0;
+            if (next == 0 || depth[next] != j + 1 - i)
+                return;
+            s = next;
+            for (std::uint32_t p = this->pattern_[s]; p != NONE; p = this->duplicate_[p])
+                length = std::min(length, report(p, i));
+        }
+    };
+    const auto prefix_candidates = kernels().prefix_candidates;
+    std::size_t i = 0;
+    for (; i + 40 <= length; i += 32) {
+        std::uint32_t candidates = prefix_candidates(haystack + i, filter, mask, shift);
+        for (; candidates; candidates &= candidates - 1)
+            match_at(i + __builtin_ctz(candidates));
+    }
+    for (; i + this->prefix_length_ <= length; ++i) {  // the last few, copied to load them whole
+        char chars[sizeof(std::uint64_t)] = {};
+        std::memcpy(chars, haystack + i, std::min(sizeof chars, length - i));
+        std::uint32_t hash = prefix_hash(chars, mask), bits = probe_bits(hash);
+        if ((filter[hash >> shift] & bits) == bits)
+            match_at(i);
+    }
+}
+
+const char *MultiSubstringSearcher::find(const char *haystack) const {
+    return this->find(haystack, strlen(haystack));
+}
+
+// The first match found may not be the first to begin, so scanning continues until no match that
+// begins earlier could still end
+const char *MultiSubstringSearcher::find(const char *haystack, std::size_t length) const {
+    std::size_t first = length;
+    this->scan(haystack, length, [&](std::size_t, std::size_t offset) {
+        first = std::min(first, offset);
+        return first + this->longest_ - 1;
+    });
+    return first < length ? haystack + first : nullptr;
+}
+
+const char *MultiSubstringSearcher::find(std::string_view haystack) const {
+    return this->find(haystack.data(), haystack.size());
+}
+
+// Matches found through the filter are sorted into the order the automaton finds them in
+void MultiSubstringSearcher::find_all(std::string_view haystack,
+                                      std::vector<SubstringMatch> &matches) const {
+    std::size_t first = matches.size();
+    this->scan(haystack.data(), haystack.size(), [&](std::size_t pattern, std::size_t offset) {
+        matches.push_back({pattern, offset});
+        return haystack.size();
+    });
+    if (this->prefix_length_) {
+        std::sort(matches.begin() + first, matches.end(),
+                  [this](const SubstringMatch &a, const SubstringMatch &b) {
+                      std::size_t a_length = this->lengths_[a.pattern];
+                      std::size_t b_length = this->lengths_[b.pattern];
+                      if (a.offset + a_length != b.offset + b_length)
+                          return a.offset + a_length < b.offset + b_length;
+                      return a_length != b_length ? a_length > b_length : a.pattern < b.pattern;
+                  });
+    }
+}
+
+std::size_t MultiSubstringSearcher::size() const {
+    return this->lengths_.size();
+}
+
+void strzip(const char *str1, const char *str2, char *output) {
+    std::string_view first(str1), second(str2);
+    std::size_t length = first.size() + second.size();
+    output[strzip(first, second, output, length)] = '\0';
+}
+
+std::size_t strzip(std::string_view str1, std::string_view str2, char *output,
+                   std::size_t capacity) {
+    std::size_t pairs = std::min({str1.size(), str2.size(), capacity / 2});
+    kernels().zip(str1.data(), str2.data(), pairs, output);
+    std::size_t written = 2 * pairs;
+    if (written < capacity && pairs < str1.size() && pairs < str2.size()) {
+        output[written++] = str1[pairs++];  // capacity is odd: one more char from str1
+        return written;
+    }
+    std::string_view rest = pairs < str1.size() ? str1.substr(pairs) : str2.substr(pairs);
+    std::size_t count = std::min(rest.size(), capacity - written);
+    std::memcpy(output + written, rest.data(), count);
+    return written + count;
+}
+
+
+char *str_rot13(char *str) {
+    return str_rot13(str, strlen(str));
+}
+
+char *str_rot13(char *str, std::size_t length) {
+    kernels().rot13(str, length);
+    return str;
+}
+
+std::size_t str_rot13_stream(std::FILE *in, std::FILE *out) {
+    std::vector<char> block(1 << 20);
+    std::size_t total = 0;
+    for (std::size_t count; (count = std::fread(block.data(), 1, block.size(), in)) > 0;) {
+        str_rot13(block.data(), count);
+        std::size_t written = std::fwrite(block.data(), 1, count, out);
+        total += written;
+        if (written != count)
+            break;
     }
-    return ptr;
+    return total;
 }
 }  // namespace cs19
\ No newline at end of file
@@ -1,19 +1,84 @@
 #ifndef CS19_C_STRINGS_H_
 #define CS19_C_STRINGS_H_
 
-#include <cstddef>  // for std::size_t
+#include <array>
+#include <charconv>  // for std::from_chars_result
+#include <cstddef>   // for std::size_t
+#include <cstdint>
+#include <cstdio>    // for std::FILE
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace cs19 {
 
 /**
  * Converts a C string to an int. The string is assumed to consist only of decimal-digit characters.
  * For example, atoi("42") returns 42. Overflow may occur if the result exceeds int's range.
+ * To detect invalid input and overflow, use from_chars() instead.
  *
  * @param str the string to convert
  * @return the converted value
  */
 unsigned atoi(const char *str);
 
+/**
+ * Converts the chars of a string view to an int, like atoi(const char *) but without scanning for
+ * a terminator.
+ *
+ * @param str the chars to convert
+ * @return the converted value
+ */
+unsigned atoi(std::string_view str);
+
+/**
+ * Parses a decimal integer at the start of a char range, like std::from_chars() in base 10: an
+ * optional '-' (for signed types only) followed by digits, with no leading whitespace or '+'.
+ * Digits are converted eight at a time where possible.
+ *
+ * Integer may be int, long or long long, or any of their unsigned versions, so in particular any of
+ * std::int32_t, std::uint32_t, std::int64_t and std::uint64_t.
+ *
+ * @param first the beginning of the chars to parse
+ * @param last the end of the chars to parse
+ * @param[out] value set to the parsed value on success, and left unchanged otherwise
+ * @return {ptr, ec}, where ptr points to the first char that is not part of the number, and ec is
+ *         std::errc() on success, std::errc::invalid_argument (with ptr == first) if there is no
+ *         number, or std::errc::result_out_of_range if the number does not fit in Integer.
+ */
+template <typename Integer>
+std::from_chars_result from_chars(const char *first, const char *last, Integer &value);
+
+/**
+ * Parses a sequence of decimal integers separated by a delimiter, e.g. one column of a CSV file or
+ * one number per line, appending each to a vector. A delimiter after the last number is allowed.
+ *
+ * @param first the beginning of the chars to parse
+ * @param last the end of the chars to parse
+ * @param delimiter the char separating the numbers, e.g. ',' or '\n'
+ * @param[out] values the vector to which parsed values are appended
+ * @return {ptr, ec}, where ec is std::errc() if every number was parsed, in which case ptr == last;
+ *         otherwise ec is the error (as for from_chars()) at the first field that could not be
+ *         parsed, or std::errc::invalid_argument if a number is followed by anything other than
+ *         the delimiter, and ptr points to where parsing stopped. The values parsed before the
+ *         error are kept.
+ */
+template <typename Integer>
+std::from_chars_result parse_integers(const char *first, const char *last, char delimiter,
+                                      std::vector<Integer> &values);
+
+/**
+ * Compares two byte arrays for lexicographic ordering, like std::memcmp(), with bytes compared as
+ * unsigned char. Blocks of 16 or 32 bytes are compared at a time to find the first mismatch.
+ *
+ * @param ptr1 the first bytes to compare
+ * @param ptr2 the second bytes to compare
+ * @param n the number of bytes to compare
+ * @return an integer less than, equal to, or greater than zero if the first n bytes of ptr1 are
+ * found, respectively, to be less than, to match, or be greater than those of ptr2.
+ */
+int memcmp(const void *ptr1, const void *ptr2, std::size_t n);
+
 /**
  * Finds the first occurrence of a character in a C string.
  *
@@ -24,16 +89,75 @@ unsigned atoi(const char *str);
  */
 const char *strchr(const char *haystack, const char needle);
 
+/**
+ * Finds the first occurrence of a character in a string view, which need not be null-terminated
+ * (e.g. a slice of a memory-mapped file). Any '\0' chars are searched like the others.
+ *
+ * @param haystack the chars to search
+ * @param needle the char to search for
+ * @return a pointer to the first char in haystack that matches needle,
+ *         or nullptr if no such value exists.
+ */
+const char *strchr(std::string_view haystack, char needle);
+
 /**
  * Compares two C strings for lexicographic ordering, i.e. ordering with respect to the numeric
  * encodings of the characters. For example, strcmp("Apple", "Banana") returns a negative value,
  * strcmp("wat", "wat") returns 0, and strcmp("apple", "Banana") returns a positive value.
  *
+ * Chars are compared as unsigned char, 16 or 32 at a time, up to the first mismatch or the end of
+ * str1.
+ *
  * @return an integer less than, equal to, or greater than zero if str1 is found, respectively, to
  * be less than, to match, or be greater than str2.
  */
 int strcmp(const char *str1, const char *str2);
 
+/**
+ * Compares two string views for lexicographic ordering, like strcmp(const char *, const char *),
+ * with chars compared as unsigned char. If one is a prefix of the other, the shorter one is less.
+ *
+ * @return an integer less than, equal to, or greater than zero if str1 is found, respectively, to
+ * be less than, to match, or be greater than str2.
+ */
+int strcmp(std::string_view str1, std::string_view str2);
+
+/**
+ * Compares at most the first n chars of two C strings, like strcmp(const char *, const char *).
+ * Neither string need be null-terminated if it has at least n chars.
+ *
+ * @return an integer less than, equal to, or greater than zero if the first n chars of str1 are
+ * found, respectively, to be less than, to match, or be greater than those of str2.
+ */
+int strncmp(const char *str1, const char *str2, std::size_t n);
+
+/**
+ * Compares many C strings with one pivot string, e.g. to partition them in a string sort. The
+ * strings are assumed to match the pivot in their first depth chars (e.g. the depth reached by a
+ * multikey quicksort or radix sort), which are skipped. The chars of upcoming strings are
+ * prefetched while each comparison runs, hiding the latency of following the pointers.
+ *
+ * @param strings the strings to compare
+ * @param count the number of strings
+ * @param pivot the string with which to compare each of them
+ * @param depth the number of chars known to match at the start of each string and the pivot
+ * @param[out] results for each string, as for strcmp(strings[i], pivot)
+ * @param[out] prefixes if not nullptr, for each string, the length of the longest common prefix of
+ *             strings[i] and pivot (at least depth), from which a sort can continue
+ */
+void strcmp_batch(const char *const *strings, std::size_t count, const char *pivot,
+                  std::size_t depth, int *results, std::size_t *prefixes = nullptr);
+
+/**
+ * Sorts C strings into strcmp() order by three-way string quicksort: each step partitions by one
+ * strcmp_batch() against a pivot, and each partition is then compared only from the common prefix
+ * that its strings are known to share, so chars known to match are not compared again.
+ *
+ * @param first the beginning of the array of strings to sort
+ * @param last the end of the array of strings to sort
+ */
+void sort_strings(const char **first, const char **last);
+
 /**
  * Calculates the length of a C string, excluding the terminating null byte ('\0').
  * For example, strlen("Hello") returns 5.
@@ -43,6 +167,15 @@ int strcmp(const char *str1, const char *str2);
  */
 std::size_t strlen(const char *str);
 
+/**
+ * Calculates the length of a C string within a bounded buffer, like POSIX strnlen(): the number of
+ * chars before the first '\0' in str, or str.size() if there is none.
+ *
+ * @param str the buffer in which to measure
+ * @return the number of chars before the first '\0', at most str.size()
+ */
+std::size_t strlen(std::string_view str);
+
 /**
  * Searches a C string for any of a set of characters.
  *
@@ -53,6 +186,17 @@ std::size_t strlen(const char *str);
  */
 const char *strpbrk(const char *haystack, const char *char_list);
 
+/**
+ * Searches a string view for any of a set of characters. Both may contain '\0' chars, which are
+ * treated like any other.
+ *
+ * @param haystack the chars to search
+ * @param char_list the set of characters for which to search
+ * @return a pointer to the first char in haystack that matches one of the char in char_list,
+ *         or nullptr if no such value exists.
+ */
+const char *strpbrk(std::string_view haystack, std::string_view char_list);
+
 /**
  * Finds the last occurrence of a character in a C string.
  *
@@ -63,6 +207,16 @@ const char *strpbrk(const char *haystack, const char *char_list);
  */
 const char *strrchr(const char *haystack, const char needle);
 
+/**
+ * Finds the last occurrence of a character in a string view, scanning backward from its end.
+ *
+ * @param haystack the chars to search
+ * @param needle the char to search for
+ * @return a pointer to the last char in haystack that matches needle,
+ *         or nullptr if no such value exists.
+ */
+const char *strrchr(std::string_view haystack, char needle);
+
 /**
  * Reverses a C string in place.
  *
@@ -71,10 +225,22 @@ const char *strrchr(const char *haystack, const char needle);
  */
 char *strrev(char *str);
 
+/**
+ * Reverses a char array in place, e.g. a large buffer that need not be null-terminated. Blocks of
+ * chars are swapped from both ends at once.
+ *
+ * @param str the chars to reverse
+ * @param length the number of chars in str
+ * @return str
+ */
+char *strrev(char *str, std::size_t length);
+
 /**
  * Finds the first occurrence of a substring needle in a C string.
  * The terminating null bytes ('\0') are not compared.
  *
+ * To search for the same needle many times, use a SubstringSearcher instead.
+ *
  * @param haystack the string in which to search
  * @param needle the string for which to search
  * @return a pointer to the beginning of the first occurrence of needle in haystack,
@@ -82,17 +248,228 @@ char *strrev(char *str);
  */
 const char *strstr(const char *haystack, const char *needle);
 
+/**
+ * Finds the first occurrence of a substring needle in a string view. Either may contain '\0'
+ * chars, which are compared like any other.
+ *
+ * @param haystack the chars in which to search
+ * @param needle the chars for which to search
+ * @return a pointer to the beginning of the first occurrence of needle in haystack,
+ *         or nullptr if no such value exists (or needle is empty).
+ */
+const char *strstr(std::string_view haystack, std::string_view needle);
+
+/**
+ * A needle preprocessed once for finding it in any number of haystacks, in worst-case linear time.
+ *
+ * Needles are found by a vectorized filter on the needle's first and last chars, which hands over
+ * to Two-Way string matching if the filter turns up too many false candidates, as on inputs over a
+ * small alphabet. For needles longer than 32 chars, Two-Way is combined with Boyer-Moore-Horspool
+ * shifts on pairs of chars, which skip up to the length of the needle (at most 255) at each step.
+ */
+class SubstringSearcher {
+ public:
+  /**
+   * Preprocesses a needle, keeping a copy of it.
+   *
+   * @param needle the string for which to search
+   */
+  explicit SubstringSearcher(const char *needle);
+
+  /**
+   * Preprocesses a needle that may contain '\0' chars, keeping a copy of it.
+   *
+   * @param needle the chars for which to search
+   */
+  explicit SubstringSearcher(std::string_view needle);
+
+  /**
+   * Finds the first occurrence of the needle in a C string, like strstr().
+   *
+   * @param haystack the string in which to search
+   * @return a pointer to the beginning of the first occurrence of the needle in haystack,
+   *         or nullptr if no such value exists (or the needle is empty).
+   */
+  const char *find(const char *haystack) const;
+
+  /**
+   * Finds the first occurrence of the needle in a char array that need not be null-terminated.
+   *
+   * @param haystack the chars in which to search
+   * @param length the number of chars in haystack
+   * @return a pointer to the beginning of the first occurrence of the needle in haystack,
+   *         or nullptr if no such value exists (or the needle is empty).
+   */
+  const char *find(const char *haystack, std::size_t length) const;
+
+  /**
+   * Finds the first occurrence of the needle in a string view.
+   *
+   * @param haystack the chars in which to search
+   * @return a pointer to the beginning of the first occurrence of the needle in haystack,
+   *         or nullptr if no such value exists (or the needle is empty).
+   */
+  const char *find(std::string_view haystack) const;
+
+  /**
+   * Returns the length of the needle.
+   */
+  std::size_t size() const;
+
+ private:
+  const char *two_way(const char *haystack, std::size_t length) const;
+
+  std::string needle_;
+  std::size_t critical_ = 0;                // where the critical factorization splits the needle
+  std::size_t period_ = 1;                  // the needle's period, or the shift after a full match
+  bool periodic_ = false;                   // whether the left part recurs one period later
+  std::array<std::uint8_t, 256> shifts_{};  // Horspool shifts by hash of a pair of chars
+};
+
+/**
+ * Struct SubstringMatch identifies an occurrence of a pattern of a MultiSubstringSearcher.
+ */
+struct SubstringMatch {
+  std::size_t pattern;  // the index of the pattern that occurs
+  std::size_t offset;   // the position in the haystack at which the occurrence begins
+
+  bool operator==(const SubstringMatch &that) const {
+    return this->pattern == that.pattern && this->offset == that.offset;
+  }
+};
+
+/**
+ * A set of patterns (e.g. thousands of keywords) compiled once for finding all of them in a single
+ * pass over any number of haystacks, by Aho-Corasick matching.
+ *
+ * The automaton is stored compactly as a double array: the transition of state s on char c is
+ * cells[s + c] if that cell is checked as belonging to s. The transitions of the shallow states,
+ * which most chars of a haystack visit, are resolved in advance up to a cache-sized budget, so
+ * each such char costs one probe, and a missing one leads where the root's table of 256 says.
+ * Deeper states store only their children and otherwise follow fail links. While no pattern is
+ * partly matched, chars that begin no pattern are skipped with the vectorized scan of strpbrk() if
+ * the patterns begin with only a few distinct chars.
+ *
+ * Large sets of patterns begin with nearly every char, and keep the automaton away from its root,
+ * so they instead filter positions by the first few chars of the patterns (up to 8, and no more
+ * than the shortest pattern has), hashed into a blocked Bloom filter: each prefix sets 3 bits of
+ * one 32-bit word, so a position costs a single load to test. Only positions whose chars find all
+ * 3 bits set are matched against the patterns, by walking the trie from there. The filter grows
+ * with the patterns up to 512 KiB, which keeps false candidates under about 1 in 500 positions
+ * even for 100000 patterns. It is skipped if too many of its bits would be set to rule out most
+ * positions, e.g. for very short patterns.
+ */
+class MultiSubstringSearcher {
+ public:
+  /**
+   * Compiles a set of patterns. Empty patterns never match, as for strstr(). The same pattern may
+   * occur more than once, in which case each of its indices is reported.
+   *
+   * @param patterns the strings for which to search
+   */
+  explicit MultiSubstringSearcher(const std::vector<std::string> &patterns);
+
+  /**
+   * Finds the first occurrence of any of the patterns in a C string, like strstr().
+   *
+   * @param haystack the string in which to search
+   * @return a pointer to the beginning of the first occurrence of a pattern in haystack,
+   *         or nullptr if no such value exists.
+   */
+  const char *find(const char *haystack) const;
+
+  /**
+   * Finds the first occurrence of any of the patterns in a char array that need not be
+   * null-terminated.
+   *
+   * @param haystack the chars in which to search
+   * @param length the number of chars in haystack
+   * @return a pointer to the beginning of the first occurrence of a pattern in haystack,
+   *         or nullptr if no such value exists.
+   */
+  const char *find(const char *haystack, std::size_t length) const;
+
+  /**
+   * Finds the first occurrence of any of the patterns in a string view.
+   *
+   * @param haystack the chars in which to search
+   * @return a pointer to the beginning of the first occurrence of a pattern in haystack,
+   *         or nullptr if no such value exists.
+   */
+  const char *find(std::string_view haystack) const;
+
+  /**
+   * Finds every occurrence of every pattern in a string view, including overlapping ones. Matches
+   * are appended in order of where they end, and longer ones first among those ending together.
+   *
+   * @param haystack the chars in which to search
+   * @param[out] matches the vector to which matches are appended
+   */
+  void find_all(std::string_view haystack, std::vector<SubstringMatch> &matches) const;
+
+  /**
+   * Returns the number of patterns.
+   */
+  std::size_t size() const;
+
+ private:
+  struct Cell {
+    std::uint32_t check;  // the state whose transition this is, or NONE if unused
+    std::uint32_t next;   // the state to which the transition leads
+  };
+
+  static constexpr std::uint32_t NONE = ~std::uint32_t{0};
+
+  template <typename Report>
+  void scan(const char *haystack, std::size_t length, Report report) const;
+
+  template <typename Report>
+  void scan_candidates(const char *haystack, std::size_t length, Report report) const;
+
+  std::vector<Cell> cells_;               // the stored transitions of every state, each state
+                                          // being numbered by its base; the root is 0
+  std::array<std::uint32_t, 256> root_{};  // the transition of the root on each char
+  std::vector<std::uint32_t> fail_;       // the state to try next if a transition is not stored
+  std::vector<std::uint32_t> output_;     // the nearest state along fail links ending a pattern
+  std::vector<std::uint32_t> next_output_;  // the next such state after each one
+  std::vector<std::uint32_t> pattern_;    // the lowest index of the pattern ending at each state
+  std::vector<std::uint32_t> duplicate_;  // the next index of the same pattern, for each pattern
+  std::vector<std::size_t> lengths_;      // the length of each pattern
+  std::size_t longest_ = 0;               // the length of the longest pattern
+  std::string first_chars_;               // the chars that begin patterns, if few enough to skip to
+  std::vector<std::uint32_t> depth_;      // the length of the prefix that each state matches
+  std::vector<std::uint32_t> filter_;     // the Bloom filter of pattern prefixes, if filtering
+  std::uint64_t prefix_mask_ = 0;         // the bits of an 8-char word holding a prefix
+  unsigned prefix_length_ = 0;            // the chars in a prefix; 0 if not filtering
+  unsigned filter_shift_ = 0;             // the shift leaving a hash's word number
+};
+
 /**
  * Composes an output C string with alternating characters from two other strings.
  * See the suggested testing code for an example.
  *
  * @param str1 the first source string
  * @param str2 the second source string
- * @param[out] output filled with characters from str1 and str2, alternating between the two. The
- * length of this array is assumed to be at least strlen(str1) + strlen(str2) + 1.
+ * @param[out] output filled with characters from str1 and str2, alternating between the two, then
+ * the rest of the longer string and a terminating '\0'. The length of this array is assumed to be
+ * at least strlen(str1) + strlen(str2) + 1.
  */
 void strzip(const char *str1, const char *str2, char *output);
 
+/**
+ * Composes alternating characters from two string views into a caller-provided buffer, starting
+ * with str1 and continuing with the rest of the longer one once the shorter one runs out. No
+ * terminator is written. Pairs of chars are interleaved a block at a time.
+ *
+ * @param str1 the first source chars
+ * @param str2 the second source chars
+ * @param[out] output the buffer to fill
+ * @param capacity the number of chars output can hold; at most this many are written
+ * @return the number of chars written: str1.size() + str2.size(), or capacity if that is less
+ */
+std::size_t strzip(std::string_view str1, std::string_view str2, char *output,
+                   std::size_t capacity);
+
 /**
  * Performs the ROT13 encoding on a C string, in place. The ROT13 encoding simply shifts every
  * English letter by 13 places in the alphabet while leaving non-English-alpha characters untouched.
@@ -105,6 +482,26 @@ void strzip(const char *str1, const char *str2, char *output);
  */
 char *str_rot13(char *str);
 
+/**
+ * Performs the ROT13 encoding on a char array in place, e.g. a large buffer that need not be
+ * null-terminated. Blocks of chars are encoded at once, without branching on each char.
+ *
+ * @param str the chars to encode
+ * @param length the number of chars in str
+ * @return str
+ */
+char *str_rot13(char *str, std::size_t length);
+
+/**
+ * Performs the ROT13 encoding on everything read from one stream, writing the result to another.
+ * The input is processed in 1 MiB blocks, so streams of any size take constant memory.
+ *
+ * @param in the stream to encode, e.g. stdin
+ * @param out the stream to which to write the encoded chars, e.g. stdout
+ * @return the number of chars written, which is less than the number read only if writing failed
+ */
+std::size_t str_rot13_stream(std::FILE *in, std::FILE *out);
+
 }  // namespace cs19
 
 #endif  // CS19_C_STRINGS_H_
@@ -2,7 +2,7 @@
  * @file cs19_dna.h
  *
  * A basic implementation of a class representing DNA that inherits most of its functionality
- * from a parent class. DO NOT MODIFY THIS FILE.
+ * from a parent class.
  *
  * @author Jeffrey Bergamini for CS 19, jeffrey.bergamini@cabrillo.edu
  */
@@ -11,6 +11,8 @@
 #define _CS19_DNA_H
  
 #include <string>
+#include <utility>
+#include "cs19_dna_stats.h"
 #include "cs19_polynucleotide.h"
  
 namespace cs19 {
@@ -22,11 +24,16 @@ namespace cs19 {
  */
 class Dna : public Polynucleotide {
  public:
+  /**
+   * The DNA complement mapping, compiled into a lookup table at compile time.
+   */
+  static constexpr ComplementTable COMPLEMENTS{{'A', 'T'}, {'T', 'A'}, {'C', 'G'}, {'G', 'C'}};
+
   /**
    * Default constructor.
    * Creates an empty DNA sequence.
    */
-  Dna() : Polynucleotide({{'A', 'T'}, {'T', 'A'}, {'C', 'G'}, {'G', 'C'}}) {
+  Dna() : Polynucleotide(COMPLEMENTS) {
     // nothing to do here other than call base-class constructor
   }
  
@@ -37,13 +44,30 @@ class Dna : public Polynucleotide {
   Dna(const Dna &that) : Polynucleotide(that) {
     // nothing to do here other than call base-class constructor
   }
+
+  /**
+   * Move constructor.
+   * Takes over the nucleotides of an expiring DNA sequence without copying them.
+   */
+  Dna(Dna &&that) noexcept : Polynucleotide(std::move(that)) {
+    // nothing to do here other than call base-class constructor
+  }
+
+  /**
+   * Polynucleotide move constructor: Takes over the nucleotides of an expiring Polynucleotide,
+   * e.g. the result of ~dna or -dna, without copying them.
+   * @throws std::domain_error if the sequence contains invalid DNA characters.
+   */
+  Dna(Polynucleotide &&that) : Polynucleotide(std::move(that), COMPLEMENTS) {
+    // nothing to do here other than call base-class constructor
+  }
  
   /**
    * C string contructor: Works with any C string containing valid nucleotide characters.
    * @throws std::domain_error for any string containing invalid nucleotide characters.
    */
   Dna(const char *contents)
-      : Polynucleotide(std::string(contents), {{'A', 'T'}, {'T', 'A'}, {'C', 'G'}, {'G', 'C'}}) {
+      : Polynucleotide(contents, COMPLEMENTS) {
     // nothing to do here other than call base-class constructor
   }
  
@@ -53,7 +77,7 @@ class Dna : public Polynucleotide {
    * @throws std::domain_error if any element in the list is an invalid DNA nucleotide character.
    */
   Dna(std::initializer_list<char> list)
-      : Polynucleotide(list, {{'A', 'T'}, {'T', 'A'}, {'C', 'G'}, {'G', 'C'}}) {
+      : Polynucleotide(list, COMPLEMENTS) {
     // nothing to do here other than call base-class constructor
   }
  
@@ -64,7 +88,7 @@ class Dna : public Polynucleotide {
    */
   template <typename Sequence>
   Dna(const Sequence &contents)
-      : Polynucleotide(contents, {{'A', 'T'}, {'T', 'A'}, {'C', 'G'}, {'G', 'C'}}) {
+      : Polynucleotide(contents, COMPLEMENTS) {
     // nothing to do here other than call base-class constructor
   }
  
@@ -79,23 +103,62 @@ class Dna : public Polynucleotide {
    */
   template <typename Sequence>
   Dna(std::initializer_list<Sequence> list)
-      : Polynucleotide(list, {{'A', 'T'}, {'T', 'A'}, {'C', 'G'}, {'G', 'C'}}) {
+      : Polynucleotide(list, COMPLEMENTS) {
     // nothing to do here other than call base-class constructor
   }
  
+  /**
+   * Copy and move assignment.
+   */
+  Dna &operator=(const Dna &that) = default;
+  Dna &operator=(Dna &&that) noexcept = default;
+
   /**
    * Returns the GC-content of this sequence.
    */
   double gc_content() const {
     if (this->size() == 0)
       return 0;
-    int gc_count = 0;
-    for (char c : this->sequence_) {
-      if (c == 'G' || c == 'C')
-        ++gc_count;
-    }
+    std::size_t gc_count =
+        kernels::active().count_either(this->sequence_.data(), this->sequence_.size(), 'G', 'C');
     return static_cast<double>(gc_count) / this->sequence_.size();
   }
+
+  /**
+   * Returns the GC-content of this sequence, splitting the work across threads.
+   * @param policy how to split the work, e.g. cs19::par
+   */
+  double gc_content(const ParallelPolicy &policy) const {
+    if (this->size() == 0)
+      return 0;
+    std::size_t gc_count = 0;
+    for (std::size_t partial : parallel::map_chunks<std::size_t>(
+             this->sequence_.size(), policy, [this](std::size_t begin, std::size_t end) {
+               return kernels::active().count_either(this->sequence_.data() + begin, end - begin,
+                                                     'G', 'C');
+             }))
+      gc_count += partial;
+    return static_cast<double>(gc_count) / this->sequence_.size();
+  }
+
+  /**
+   * Returns the GC-content of each complete window of this sequence, with windows of the given
+   * length starting every step nucleotides. Runs in time proportional to the sequence length.
+   * @throws std::domain_error if window or step is zero
+   */
+  std::vector<double> windowed_gc_content(std::size_t window, std::size_t step) const {
+    return cs19::windowed_gc_content(this->sequence_, window, step);
+  }
+
+  /**
+   * Returns the frequencies of every k-mer (length-k subsequence) of this sequence.
+   * @throws std::domain_error if k is zero or greater than KmerCounter::MAX_K (31)
+   */
+  KmerCounter kmer_counts(unsigned k) const {
+    KmerCounter counter(k);
+    counter.add(this->sequence_);
+    return counter;
+  }
 };
  
 }  // namespace cs19
@@ -0,0 +1,181 @@
+/**
+ * @file cs19_dna_distance.h
+ *
+ * Batch Hamming distances over collections of equal-length DNA sequences (e.g. barcodes): a full
+ * all-pairs distance matrix, or the k nearest neighbors of every sequence.
+ */
+#ifndef _CS19_DNA_DISTANCE_H
+#define _CS19_DNA_DISTANCE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "cs19_dna.h"
+#include "cs19_packed_dna.h"
+#include "cs19_parallel.h"
+
+namespace cs19 {
+
+/**
+ * Struct DistanceMatrix holds the symmetric matrix of pairwise distances between n sequences.
+ */
+struct DistanceMatrix {
+  std::size_t size = 0;                  // the number of sequences, n
+  std::vector<std::uint32_t> distances;  // n * n distances, row-major
+
+  std::uint32_t operator()(std::size_t i, std::size_t j) const {
+    return this->distances[i * this->size + j];
+  }
+};
+
+/**
+ * Struct Neighbor identifies one sequence by index along with its distance from another.
+ */
+struct Neighbor {
+  std::size_t index;
+  std::uint32_t distance;
+
+  bool operator==(const Neighbor &that) const {
+    return this->index == that.index && this->distance == that.distance;
+  }
+};
+
+namespace distance {
+
+constexpr std::size_t TILE = 64;  // sequences per tile: a tile pair's packed words stay in cache
+
+// Every sequence packed at 2 bits per nucleotide, stored back to back for locality
+class PackedBatch {
+ public:
+  explicit PackedBatch(const std::vector<Dna> &sequences) : count_(sequences.size()) {
+    if (sequences.empty())
+      return;
+    std::size_t length = sequences[0].size();
+    this->words_per_ = (length + PackedDna::BASES_PER_WORD - 1) / PackedDna::BASES_PER_WORD;
+    this->words_.reserve(this->count_ * this->words_per_);
+    for (const Dna &dna : sequences) {
+      if (dna.size() != length)
+        throw std::domain_error("String sizes not equal");
+      PackedDna packed(dna);
+      this->words_.insert(this->words_.end(), packed.words().begin(), packed.words().end());
+    }
+  }
+
+  std::size_t size() const {
+    return this->count_;
+  }
+
+  // XOR the two sequences' words; a nucleotide differs if either bit of its 2-bit code differs
+  std::uint32_t distance(std::size_t i, std::size_t j) const {
+    const std::uint64_t *a = &this->words_[i * this->words_per_];
+    const std::uint64_t *b = &this->words_[j * this->words_per_];
+    std::uint32_t total = 0;
+    for (std::size_t w = 0; w < this->words_per_; ++w) {
+      std::uint64_t diff = a[w] ^ b[w];
+      total += __builtin_popcountll((diff | (diff >> 1)) & 0x5555555555555555);
+    }
+    return total;
+  }
+
+ private:
+  std::size_t count_;
+  std::size_t words_per_ = 0;
+  std::vector<std::uint64_t> words_;
+};
+
+}  // namespace distance
+
+/**
+ * Computes the Hamming distance between every pair of sequences, with sequences packed to 2 bits
+ * per nucleotide and compared by XOR and popcount. The upper triangle is split into tiles of
+ * sequences that are processed concurrently; each distance is computed once and mirrored.
+ *
+ * @param sequences the sequences, all of the same length
+ * @param policy how to split the work, e.g. cs19::par
+ * @throws std::domain_error if the sequences are of unequal length
+ */
+inline DistanceMatrix hamming_matrix(const std::vector<Dna> &sequences,
+                                     const ParallelPolicy &policy = par) {
+  distance::PackedBatch batch(sequences);
+  std::size_t n = batch.size(), tiles = (n + distance::TILE - 1) / distance::TILE;
+  std::vector<std::pair<std::size_t, std::size_t>> tile_pairs;
+  for (std::size_t row = 0; row < tiles; ++row) {
+    for (std::size_t column = row; column < tiles; ++column)
+      tile_pairs.emplace_back(row, column);
+  }
+  DistanceMatrix matrix{n, std::vector<std::uint32_t>(n * n)};
+  ParallelPolicy per_tile = policy;
+  per_tile.min_chunk = 1;
+  parallel::for_each_chunk(
+      tile_pairs.size(), per_tile, [&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t) {
+          auto [row_tile, column_tile] = tile_pairs[t];
+          std::size_t row_end = std::min(n, (row_tile + 1) * distance::TILE);
+          std::size_t column_end = std::min(n, (column_tile + 1) * distance::TILE);
+          for (std::size_t i = row_tile * distance::TILE; i < row_end; ++i) {
+            std::size_t j = row_tile == column_tile ? i + 1 : column_tile * distance::TILE;
+            for (; j < column_end; ++j)
+              matrix.distances[i * n + j] = matrix.distances[j * n + i] = batch.distance(i, j);
+          }
+        }
+      });
+  return matrix;
+}
+
+/**
+ * Finds the k nearest neighbors (by Hamming distance) of every sequence, excluding itself. Each
+ * result is sorted by increasing distance, with ties broken by lower index, so results are
+ * deterministic. Rows are split across threads and scanned tile by tile against all columns.
+ *
+ * @param sequences the sequences, all of the same length
+ * @param k the number of neighbors to find (fewer if there are not enough sequences)
+ * @param policy how to split the work, e.g. cs19::par
+ * @throws std::domain_error if the sequences are of unequal length
+ */
+inline std::vector<std::vector<Neighbor>> nearest_neighbors(const std::vector<Dna> &sequences,
+                                                            std::size_t k,
+                                                            const ParallelPolicy &policy = par) {
+  distance::PackedBatch batch(sequences);
+  std::size_t n = batch.size();
+  k = std::min(k, n ? n - 1 : 0);
+  std::vector<std::vector<Neighbor>> neighbors(n);
+  auto closer = [](const Neighbor &a, const Neighbor &b) {
+    return a.distance != b.distance ? a.distance < b.distance : a.index < b.index;
+  };
+  ParallelPolicy per_tile = policy;
+  per_tile.min_chunk = distance::TILE;
+  parallel::for_each_chunk(n, per_tile, [&](std::size_t, std::size_t begin, std::size_t end) {
+    for (std::size_t row_start = begin; row_start < end; row_start += distance::TILE) {
+      std::size_t row_end = std::min(end, row_start + distance::TILE);
+      for (std::size_t column_start = 0; column_start < n; column_start += distance::TILE) {
+        std::size_t column_end = std::min(n, column_start + distance::TILE);
+        for (std::size_t i = row_start; i < row_end; ++i) {
+          auto &heap = neighbors[i];  // a max-heap of the k closest so far
+          for (std::size_t j = column_start; j < column_end && k; ++j) {
+            if (j == i)
+              continue;
+            Neighbor candidate{j, batch.distance(i, j)};
+            if (heap.size() < k) {
+              heap.push_back(candidate);
+              std::push_heap(heap.begin(), heap.end(), closer);
+            } else if (closer(candidate, heap.front())) {
+              std::pop_heap(heap.begin(), heap.end(), closer);
+              heap.back() = candidate;
+              std::push_heap(heap.begin(), heap.end(), closer);
+            }
+          }
+        }
+      }
+      for (std::size_t i = row_start; i < row_end; ++i)
+        std::sort_heap(neighbors[i].begin(), neighbors[i].end(), closer);
+    }
+  });
+  return neighbors;
+}
+
+}  // namespace cs19
+
+#endif  // _CS19_DNA_DISTANCE_H
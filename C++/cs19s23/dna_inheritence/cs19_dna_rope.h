@@ -0,0 +1,282 @@
+/**
+ * @file cs19_dna_rope.h
+ *
+ * An opt-in rope representation for DNA sequences that are concatenated, sliced and copied far more
+ * often than they are modified, e.g. contigs during assembly.
+ */
+#ifndef _CS19_DNA_ROPE_H
+#define _CS19_DNA_ROPE_H
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "cs19_dna.h"
+
+namespace cs19 {
+
+/**
+ * Class DnaRope models a DNA sequence as a balanced binary tree of immutable, reference-counted
+ * chunks. Trees are never modified once built, so any number of ropes may share them:
+ *
+ * - copying a DnaRope is O(1);
+ * - concatenation and subsequence are O(log n) in the number of chunks, sharing the operands'
+ *   nodes and slicing chunks without copying nucleotides;
+ * - set() rebuilds only the path to the changed nucleotide, leaving other copies untouched.
+ *
+ * Trees are kept height-balanced like AVL trees: the heights of every node's subtrees differ by at
+ * most one, so depth stays logarithmic however a rope is built.
+ */
+class DnaRope {
+ public:
+  /**
+   * Default constructor: Creates an empty sequence.
+   */
+  DnaRope() = default;
+
+  /**
+   * Creates a rope holding a copy of valid DNA characters as a single chunk.
+   * @throws std::domain_error for any string containing invalid DNA characters.
+   */
+  explicit DnaRope(std::string_view contents)
+      : root_(make_leaf(std::make_shared<const std::string>(validated(contents)), 0,
+                        contents.size())) {}
+
+  explicit DnaRope(const std::string &contents) : DnaRope(std::string_view(contents)) {}
+
+  explicit DnaRope(const char *contents) : DnaRope(std::string_view(contents)) {}
+
+  /**
+   * Creates a rope holding a copy of an existing DNA sequence as a single chunk.
+   */
+  explicit DnaRope(const Dna &dna)
+      : root_(make_leaf(std::make_shared<const std::string>(dna.view()), 0, dna.size())) {}
+
+  /**
+   * Returns the nucleotide at the given position, in O(log n) time.
+   * @throws std::out_of_range if pos is not a valid position
+   */
+  char operator[](std::size_t pos) const {
+    if (pos >= this->size())
+      throw std::out_of_range("Position out of range");
+    const Node *node = this->root_.get();
+    while (!node->chunk) {
+      if (pos < node->left->size) {
+        node = node->left.get();
+      } else {
+        pos -= node->left->size;
+        node = node->right.get();
+      }
+    }
+    return (*node->chunk)[node->offset + pos];
+  }
+
+  /**
+   * Addition operator: Returns this sequence concatenated with another, sharing both.
+   */
+  DnaRope operator+(const DnaRope &that) const {
+    return DnaRope(join(this->root_, that.root_));
+  }
+
+  /**
+   * Compound addition/assignment: Appends another sequence to this one, sharing it.
+   */
+  DnaRope &operator+=(const DnaRope &appendage) {
+    this->root_ = join(this->root_, appendage.root_);
+    return *this;
+  }
+
+  /**
+   * Logical equality: Two ropes compare equal if they contain the same sequence of nucleotides,
+   * regardless of how they are divided into chunks.
+   */
+  bool operator==(const DnaRope &that) const {
+    return this->size() == that.size() && this->to_string() == that.to_string();
+  }
+
+  /**
+   * Stream insertion operator: object will appear as a plain string sequence, e.g. "GATTACA".
+   */
+  friend std::ostream &operator<<(std::ostream &out, const DnaRope &rope) {
+    rope.for_each_chunk([&out](std::string_view chunk) { out << chunk; });
+    return out;
+  }
+
+  /**
+   * Returns the length of this sequence.
+   */
+  std::size_t size() const {
+    return this->root_ ? this->root_->size : 0;
+  }
+
+  /**
+   * Sets the value of the nucleotide at the given position, copying only O(log n) tree nodes.
+   * @throws std::domain_error if nucleotide is an invalid character
+   * @throws std::out_of_range if pos is not a valid position
+   */
+  void set(std::size_t pos, char nucleotide) {
+    if (!Dna::COMPLEMENTS.is_valid(nucleotide))
+      throw std::domain_error("Invalid Character");
+    if (pos >= this->size())
+      throw std::out_of_range("Position out of range");
+    NodePtr replacement = make_leaf(std::make_shared<const std::string>(1, nucleotide), 0, 1);
+    this->root_ = join(join(slice(this->root_, 0, pos), replacement),
+                       slice(this->root_, pos + 1, this->size() - pos - 1));
+  }
+
+  /**
+   * Returns a rope sharing this one's chunks for the portion that starts at position pos and spans
+   * count nucleotides (or until the end, whichever comes first), in O(log n) time.
+   * @throws std::out_of_range if pos is greater than the length of this sequence
+   */
+  DnaRope subsequence(std::size_t pos, std::size_t count) const {
+    if (pos > this->size())
+      throw std::out_of_range("Position out of range");
+    return DnaRope(slice(this->root_, pos, std::min(count, this->size() - pos)));
+  }
+
+  /**
+   * Calls fn(std::string_view) for each chunk of this sequence, in order.
+   */
+  template <typename Function>
+  void for_each_chunk(Function fn) const {
+    std::vector<const Node *> pending;
+    if (this->root_)
+      pending.push_back(this->root_.get());
+    while (!pending.empty()) {
+      const Node *node = pending.back();
+      pending.pop_back();
+      if (node->chunk) {
+        fn(std::string_view(*node->chunk).substr(node->offset, node->size));
+      } else {
+        pending.push_back(node->right.get());
+        pending.push_back(node->left.get());
+      }
+    }
+  }
+
+  /**
+   * Returns a string containing this sequence's nucleotides.
+   */
+  std::string to_string() const {
+    std::string flattened;
+    flattened.reserve(this->size());
+    this->for_each_chunk([&flattened](std::string_view chunk) { flattened += chunk; });
+    return flattened;
+  }
+
+  /**
+   * Returns a flat cs19::Dna containing this sequence's nucleotides.
+   */
+  Dna to_dna() const {
+    Dna dna;
+    dna.reserve(this->size());
+    this->for_each_chunk([&dna](std::string_view chunk) { dna += chunk; });
+    return dna;
+  }
+
+ private:
+  struct Node;
+  using NodePtr = std::shared_ptr<const Node>;
+
+  // A leaf refers to a slice of a shared chunk; an internal node to two non-empty subtrees
+  struct Node {
+    std::size_t size = 0;
+    unsigned depth = 0;  // the height of the subtree: 0 for leaves
+    std::shared_ptr<const std::string> chunk;  // leaves only
+    std::size_t offset = 0;                    // leaves only
+    NodePtr left, right;                       // internal nodes only
+  };
+
+  explicit DnaRope(NodePtr root) : root_(std::move(root)) {}
+
+  static std::string validated(std::string_view contents) {
+    if (Dna::COMPLEMENTS.find_invalid(contents.data(), contents.size()) != contents.size())
+      throw std::domain_error("Invalid Character");
+    return std::string(contents);
+  }
+
+  static NodePtr make_leaf(std::shared_ptr<const std::string> chunk, std::size_t offset,
+                           std::size_t size) {
+    if (size == 0)
+      return nullptr;
+    auto leaf = std::make_shared<Node>();
+    leaf->size = size;
+    leaf->chunk = std::move(chunk);
+    leaf->offset = offset;
+    return leaf;
+  }
+
+  static NodePtr make_internal(NodePtr left, NodePtr right) {
+    auto node = std::make_shared<Node>();
+    node->size = left->size + right->size;
+    node->depth = std::max(left->depth, right->depth) + 1;
+    node->left = std::move(left);
+    node->right = std::move(right);
+    return node;
+  }
+
+  // Concatenates two balanced trees into one, AVL-style: the taller tree's spine is descended to
+  // a subtree about as tall as the shorter tree, which are joined there and rebalanced on the way
+  // back up. This creates O(|difference in depth|) nodes, at most O(log n).
+  static NodePtr join(NodePtr left, NodePtr right) {
+    if (!left)
+      return right;
+    if (!right)
+      return left;
+    if (left->depth > right->depth + 1)
+      return balanced(left->left, join(left->right, std::move(right)));
+    if (right->depth > left->depth + 1)
+      return balanced(join(std::move(left), right->left), right->right);
+    return make_internal(std::move(left), std::move(right));
+  }
+
+  // Joins two balanced trees whose depths differ by at most two, rotating if they differ by two
+  static NodePtr balanced(NodePtr left, NodePtr right) {
+    if (left->depth > right->depth + 1) {
+      if (left->left->depth >= left->right->depth)
+        return make_internal(left->left, make_internal(left->right, std::move(right)));
+      const NodePtr &inner = left->right;
+      return make_internal(make_internal(left->left, inner->left),
+                           make_internal(inner->right, std::move(right)));
+    }
+    if (right->depth > left->depth + 1) {
+      if (right->right->depth >= right->left->depth)
+        return make_internal(make_internal(std::move(left), right->left), right->right);
+      const NodePtr &inner = right->left;
+      return make_internal(make_internal(std::move(left), inner->left),
+                           make_internal(inner->right, right->right));
+    }
+    return make_internal(std::move(left), std::move(right));
+  }
+
+  // Returns the tree for nucleotides [pos, pos + count) of node, sharing whole subtrees in range
+  static NodePtr slice(const NodePtr &node, std::size_t pos, std::size_t count) {
+    if (!node || count == 0)
+      return nullptr;
+    if (pos == 0 && count == node->size)
+      return node;
+    if (node->chunk)
+      return make_leaf(node->chunk, node->offset + pos, count);
+    std::size_t left_size = node->left->size;
+    NodePtr left, right;
+    if (pos < left_size)
+      left = slice(node->left, pos, std::min(count, left_size - pos));
+    if (pos + count > left_size) {
+      std::size_t right_pos = pos > left_size ? pos - left_size : 0;
+      right = slice(node->right, right_pos, pos + count - left_size - right_pos);
+    }
+    return join(std::move(left), std::move(right));
+  }
+
+  NodePtr root_;  // nullptr for an empty sequence
+};
+
+}  // namespace cs19
+
+#endif  // _CS19_DNA_ROPE_H
@@ -0,0 +1,281 @@
+/**
+ * @file cs19_dna_stats.h
+ *
+ * Streaming statistics over DNA nucleotides: GC content over a sliding window, and k-mer frequency
+ * counting with k-mers packed into 64-bit keys.
+ */
+#ifndef _CS19_DNA_STATS_H
+#define _CS19_DNA_STATS_H
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cs19 {
+
+/**
+ * Class SlidingGcContent tracks the GC content of the most recent nucleotides pushed into it, over
+ * a window of fixed length. Each push updates the statistic in O(1) time.
+ */
+class SlidingGcContent {
+ public:
+  /**
+   * Creates an empty sliding window.
+   * @param window the number of nucleotides in the window
+   * @throws std::domain_error if window is zero
+   */
+  explicit SlidingGcContent(std::size_t window) : ring_(window) {
+    if (window == 0)
+      throw std::domain_error("Window size is zero");
+  }
+
+  /**
+   * Adds a nucleotide to the window, evicting the oldest if the window is full.
+   */
+  void push(char nucleotide) {
+    bool is_gc = nucleotide == 'G' || nucleotide == 'C';
+    if (this->seen_ >= this->ring_.size())
+      this->gc_count_ -= this->ring_[this->next_];
+    this->ring_[this->next_] = is_gc;
+    this->gc_count_ += is_gc;
+    this->next_ = this->next_ + 1 == this->ring_.size() ? 0 : this->next_ + 1;
+    ++this->seen_;
+  }
+
+  /**
+   * Returns whether a full window of nucleotides has been pushed.
+   */
+  bool full() const {
+    return this->seen_ >= this->ring_.size();
+  }
+
+  /**
+   * Returns the GC content of the nucleotides currently in the window (0 if empty).
+   */
+  double value() const {
+    std::size_t in_window = this->full() ? this->ring_.size() : this->seen_;
+    return in_window ? static_cast<double>(this->gc_count_) / in_window : 0;
+  }
+
+ private:
+  std::vector<unsigned char> ring_;  // whether each nucleotide in the window is G or C
+  std::size_t next_ = 0;             // ring position of the next nucleotide
+  std::size_t seen_ = 0;             // total nucleotides pushed
+  std::size_t gc_count_ = 0;         // G/C nucleotides currently in the window
+};
+
+/**
+ * Returns the GC content of each window of the given length, starting every step nucleotides, over
+ * a sequence of nucleotides. Only complete windows are reported. The count is updated
+ * incrementally as the window slides, so the cost is O(1) per nucleotide rather than per window.
+ *
+ * @throws std::domain_error if window or step is zero
+ */
+inline std::vector<double> windowed_gc_content(std::string_view nucleotides, std::size_t window,
+                                               std::size_t step) {
+  if (window == 0 || step == 0)
+    throw std::domain_error("Window and step must be positive");
+  std::vector<double> contents;
+  if (window > nucleotides.size())
+    return contents;
+  contents.reserve((nucleotides.size() - window) / step + 1);
+  auto is_gc = [&nucleotides](std::size_t pos) {
+    return nucleotides[pos] == 'G' || nucleotides[pos] == 'C';
+  };
+  std::size_t gc_count = 0;
+  for (std::size_t pos = 0; pos < window; ++pos)
+    gc_count += is_gc(pos);
+  for (std::size_t start = 0;;) {
+    contents.push_back(static_cast<double>(gc_count) / window);
+    std::size_t next = start + step;
+    if (next + window > nucleotides.size())
+      break;
+    if (step < window) {  // slide: drop what left the window, add what entered
+      for (std::size_t pos = start; pos < next; ++pos)
+        gc_count -= is_gc(pos);
+      for (std::size_t pos = start + window; pos < next + window; ++pos)
+        gc_count += is_gc(pos);
+    } else {  // no overlap: count the next window afresh
+      gc_count = 0;
+      for (std::size_t pos = next; pos < next + window; ++pos)
+        gc_count += is_gc(pos);
+    }
+    start = next;
+  }
+  return contents;
+}
+
+/**
+ * Class KmerCounter counts the k-mers (length-k substrings) of DNA sequences, for k up to 31.
+ *
+ * Each k-mer is packed at 2 bits per nucleotide (A=0, C=1, G=2, T=3) into a 64-bit key, rolled
+ * forward one nucleotide at a time. Counts are kept in an open-addressing hash table with linear
+ * probing over a single flat array of key/count pairs, so lookups touch one or two cache lines.
+ */
+class KmerCounter {
+ public:
+  static constexpr unsigned MAX_K = 31;
+
+  /**
+   * Creates an empty counter.
+   * @param k the k-mer length
+   * @throws std::domain_error if k is zero or greater than MAX_K
+   */
+  explicit KmerCounter(unsigned k) : k_(k) {
+    if (k == 0 || k > MAX_K)
+      throw std::domain_error("k must be between 1 and 31");
+    this->mask_ = (std::uint64_t{1} << (2 * k)) - 1;  // only once 2k is known to be below 64
+    this->slots_.resize(INITIAL_CAPACITY, Slot{EMPTY, 0});
+  }
+
+  /**
+   * Counts every k-mer ending in the given nucleotides. The k-mer window carries over between
+   * calls, so a sequence may be added in chunks; call end_sequence() between separate sequences.
+   * @throws std::domain_error if the nucleotides include a character other than A, C, G or T
+   */
+  void add(std::string_view nucleotides) {
+    for (char nucleotide : nucleotides) {
+      std::uint8_t code = ENCODE[static_cast<unsigned char>(nucleotide)];
+      if (code > 3)
+        throw std::domain_error("Invalid Character");
+      this->rolling_ = ((this->rolling_ << 2) | code) & this->mask_;
+      if (++this->filled_ >= this->k_)
+        this->increment(this->rolling_);
+    }
+  }
+
+  /**
+   * Marks the end of a sequence, so that no k-mer spans it and the next call to add().
+   */
+  void end_sequence() {
+    this->rolling_ = 0;
+    this->filled_ = 0;
+  }
+
+  /**
+   * Returns the number of times the given k-mer has been seen (0 if it is not a valid k-mer).
+   */
+  std::uint64_t count(std::string_view kmer) const {
+    if (kmer.size() != this->k_)
+      return 0;
+    std::uint64_t key = 0;
+    for (char nucleotide : kmer) {
+      std::uint8_t code = ENCODE[static_cast<unsigned char>(nucleotide)];
+      if (code > 3)
+        return 0;
+      key = (key << 2) | code;
+    }
+    const Slot &slot = this->slots_[this->find(key)];
+    return slot.key == key ? slot.count : 0;
+  }
+
+  /**
+   * Returns the number of distinct k-mers seen.
+   */
+  std::size_t distinct() const {
+    return this->distinct_;
+  }
+
+  /**
+   * Returns the total number of k-mers seen.
+   */
+  std::uint64_t total() const {
+    return this->total_;
+  }
+
+  unsigned k() const {
+    return this->k_;
+  }
+
+  /**
+   * Calls fn(std::uint64_t key, std::uint64_t count) for each distinct k-mer, in no particular
+   * order. Keys can be turned back into strings with decode().
+   */
+  template <typename Function>
+  void for_each(Function fn) const {
+    for (const Slot &slot : this->slots_) {
+      if (slot.key != EMPTY)
+        fn(slot.key, slot.count);
+    }
+  }
+
+  /**
+   * Returns the k-mer string for a packed key produced by this counter.
+   */
+  std::string decode(std::uint64_t key) const {
+    std::string kmer(this->k_, 'A');
+    for (std::size_t i = this->k_; i-- > 0; key >>= 2)
+      kmer[i] = "ACGT"[key & 3];
+    return kmer;
+  }
+
+ private:
+  struct Slot {
+    std::uint64_t key;
+    std::uint64_t count;
+  };
+
+  static constexpr std::uint64_t EMPTY = ~std::uint64_t{0};  // no 62-bit k-mer key is all ones
+  static constexpr unsigned INITIAL_BITS = 10;              // log2 of the initial slot count
+  static constexpr std::size_t INITIAL_CAPACITY = std::size_t{1} << INITIAL_BITS;
+  static constexpr std::array<std::uint8_t, 256> ENCODE = [] {
+    std::array<std::uint8_t, 256> table{};
+    for (auto &code : table)
+      code = 0xFF;
+    table['A'] = 0;
+    table['C'] = 1;
+    table['G'] = 2;
+    table['T'] = 3;
+    return table;
+  }();
+
+  // Returns the slot holding key, or the empty slot where it belongs
+  std::size_t find(std::uint64_t key) const {
+    std::size_t mask = this->slots_.size() - 1;
+    // Fibonacci hashing spreads nearby keys; its top log2(slots) bits are the best mixed
+    std::size_t pos = static_cast<std::size_t>((key * 0x9E3779B97F4A7C15) >> this->shift_);
+    while (this->slots_[pos].key != key && this->slots_[pos].key != EMPTY)
+      pos = (pos + 1) & mask;
+    return pos;
+  }
+
+  void increment(std::uint64_t key) {
+    std::size_t pos = this->find(key);
+    if (this->slots_[pos].key == EMPTY) {
+      if (2 * (this->distinct_ + 1) > this->slots_.size()) {  // keep the load factor <= 1/2
+        this->grow();
+        pos = this->find(key);
+      }
+      this->slots_[pos].key = key;
+      ++this->distinct_;
+    }
+    ++this->slots_[pos].count;
+    ++this->total_;
+  }
+
+  void grow() {
+    std::vector<Slot> old(2 * this->slots_.size(), Slot{EMPTY, 0});
+    old.swap(this->slots_);
+    --this->shift_;
+    for (const Slot &slot : old) {
+      if (slot.key != EMPTY)
+        this->slots_[this->find(slot.key)] = slot;
+    }
+  }
+
+  unsigned k_;
+  std::uint64_t mask_ = 0;              // the low 2k bits
+  unsigned shift_ = 64 - INITIAL_BITS;  // 64 - log2(slots_.size()), leaving a slot number
+  std::uint64_t rolling_ = 0;           // the most recent k nucleotides, packed
+  std::size_t filled_ = 0;              // nucleotides added since the last end_sequence()
+  std::size_t distinct_ = 0;
+  std::uint64_t total_ = 0;
+  std::vector<Slot> slots_;
+};
+
+}  // namespace cs19
+
+#endif  // _CS19_DNA_STATS_H
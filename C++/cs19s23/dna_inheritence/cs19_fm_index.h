@@ -0,0 +1,327 @@
+/**
+ * @file cs19_fm_index.h
+ *
+ * An FM-index over a DNA sequence: a compressed suffix-array-based index answering motif count and
+ * locate queries in time proportional to the motif length, which can be saved to disk and
+ * memory-mapped back in without any parsing or copying. POSIX only (see cs19_sequence_file.h).
+ */
+#ifndef _CS19_FM_INDEX_H
+#define _CS19_FM_INDEX_H
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "cs19_dna.h"
+#include "cs19_sequence_file.h"
+
+namespace cs19 {
+
+/**
+ * Class FmIndex indexes a DNA sequence for substring search.
+ *
+ * It stores the Burrows-Wheeler transform of the sequence at 2 bits per nucleotide, occurrence
+ * counts checkpointed every 128 rows, and a sample of the suffix array (every sample_rate-th text
+ * position). count() takes O(m) time for a motif of length m, and locate() additionally takes
+ * O(sample_rate) time per occurrence.
+ *
+ * All of the index lives in one array of 64-bit words laid out exactly as it is on disk, so load()
+ * simply maps a saved file and points into it.
+ */
+class FmIndex {
+ public:
+  /**
+   * Builds an index over a DNA sequence.
+   * @param dna the sequence to index
+   * @param sample_rate the suffix array sampling interval, trading memory for locate() speed
+   */
+  explicit FmIndex(const Dna &dna, std::uint64_t sample_rate = 32)
+      : FmIndex(dna.view(), sample_rate) {}
+
+  /**
+   * Builds an index over a sequence of A/C/G/T characters.
+   * @throws std::domain_error if the sequence contains any other character, or sample_rate is 0
+   */
+  explicit FmIndex(std::string_view nucleotides, std::uint64_t sample_rate = 32) {
+    if (sample_rate == 0)
+      throw std::domain_error("Sample rate is zero");
+    std::uint64_t n = nucleotides.size(), rows = n + 1;
+    for (char nucleotide : nucleotides) {
+      if (code(nucleotide) > 3)
+        throw std::domain_error("Invalid Character");
+    }
+    std::vector<std::uint64_t> suffixes = suffix_array(nucleotides);
+
+    Layout layout(n, sample_rate);
+    this->storage_.assign(layout.total_words, 0);
+    std::uint64_t *words = this->storage_.data();
+    words[0] = MAGIC;
+    words[1] = n;
+    words[3] = sample_rate;
+    std::uint64_t *bwt = words + layout.bwt, *occ = words + layout.occ;
+    std::uint64_t *marks = words + layout.marks, *mark_ranks = words + layout.mark_ranks;
+    std::uint64_t *samples = words + layout.samples;
+    std::array<std::uint64_t, 4> counts{};
+    for (std::uint64_t row = 0; row < rows; ++row) {
+      if (row % ROWS_PER_BLOCK == 0)
+        std::copy(counts.begin(), counts.end(), occ + 4 * (row / ROWS_PER_BLOCK));
+      std::uint64_t position = suffixes[row];
+      if (position == 0) {
+        words[2] = row;  // the '$' row, stored as an 'A' that occ() discounts
+      } else {
+        std::uint64_t c = code(nucleotides[position - 1]);
+        bwt[row / 32] |= c << (2 * (row % 32));
+        ++counts[c];
+      }
+      if (position % sample_rate == 0)
+        marks[row / 64] |= std::uint64_t{1} << (row % 64);
+    }
+    std::copy(counts.begin(), counts.end(), occ + 4 * layout.blocks);
+    std::uint64_t total = 1;  // first rows are those starting with '$', then 'A', 'C', ...
+    for (int c = 0; c < 4; ++c) {
+      words[4 + c] = total;
+      total += counts[c];
+    }
+    for (std::uint64_t word = 0, rank = 0; word < layout.mark_words; ++word) {
+      mark_ranks[word] = rank;
+      rank += __builtin_popcountll(marks[word]);
+    }
+    for (std::uint64_t row = 0, sample = 0; row < rows; ++row) {
+      if (suffixes[row] % sample_rate == 0)
+        samples[sample++] = suffixes[row];
+    }
+    this->bind(words);
+  }
+
+  explicit FmIndex(const std::string &nucleotides, std::uint64_t sample_rate = 32)
+      : FmIndex(std::string_view(nucleotides), sample_rate) {}
+
+  explicit FmIndex(const char *nucleotides, std::uint64_t sample_rate = 32)
+      : FmIndex(std::string_view(nucleotides), sample_rate) {}
+
+  FmIndex(FmIndex &&) = default;
+  FmIndex &operator=(FmIndex &&) = default;
+
+  /**
+   * Memory-maps an index previously written by save(). The file is not read up front; pages are
+   * faulted in as queries touch them.
+   * @throws std::system_error if the file cannot be mapped
+   * @throws std::domain_error if the file is not a valid index
+   */
+  static FmIndex load(const std::string &path) {
+    FmIndex index;
+    index.mapping_ = std::make_unique<MappedFile>(path);
+    std::string_view contents = index.mapping_->contents();
+    const auto *words = reinterpret_cast<const std::uint64_t *>(contents.data());
+    if (contents.size() < HEADER_WORDS * 8 || words[0] != MAGIC || words[3] == 0 ||
+        contents.size() != Layout(words[1], words[3]).total_words * 8)
+      throw std::domain_error("Not a valid FM-index file");
+    index.bind(words);
+    return index;
+  }
+
+  /**
+   * Writes this index to a file that load() can map.
+   * @throws std::system_error if the file cannot be written
+   */
+  void save(const std::string &path) const {
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path.c_str(), "wb"),
+                                                           std::fclose);
+    std::size_t bytes = Layout(this->size_, this->sample_rate_).total_words * 8;
+    if (!file || std::fwrite(this->words_, 1, bytes, file.get()) != bytes ||
+        std::fflush(file.get()) != 0)
+      throw std::system_error(errno, std::generic_category(), "write " + path);
+  }
+
+  /**
+   * Returns the number of occurrences of a motif in the indexed sequence.
+   */
+  std::size_t count(std::string_view pattern) const {
+    auto [first, last] = this->rows_matching(pattern);
+    return last - first;
+  }
+
+  /**
+   * Returns the starting positions of every occurrence of a motif, in increasing order.
+   */
+  std::vector<std::size_t> locate(std::string_view pattern) const {
+    auto [first, last] = this->rows_matching(pattern);
+    std::vector<std::size_t> positions;
+    positions.reserve(last - first);
+    for (std::uint64_t row = first; row < last; ++row) {
+      std::uint64_t steps = 0;
+      for (std::uint64_t current = row;; ++steps) {  // walk back to a sampled suffix
+        if (this->marks_[current / 64] >> (current % 64) & 1) {
+          positions.push_back(this->samples_[this->mark_rank(current)] + steps);
+          break;
+        }
+        current = this->lf(current);
+      }
+    }
+    std::sort(positions.begin(), positions.end());
+    return positions;
+  }
+
+  /**
+   * Returns the length of the indexed sequence.
+   */
+  std::size_t size() const {
+    return this->size_;
+  }
+
+ private:
+  static constexpr std::uint64_t MAGIC = 0x3149584d46393153;  // "S19FMXI1" little-endian
+  static constexpr std::uint64_t HEADER_WORDS = 8;  // magic, n, '$' row, sample rate, C[4]
+  static constexpr std::uint64_t ROWS_PER_BLOCK = 128;
+  static constexpr std::uint64_t LOW_BITS = 0x5555555555555555;
+
+  // Word offsets of each array within the index, all derived from the sequence length
+  struct Layout {
+    std::uint64_t blocks, mark_words, bwt, occ, marks, mark_ranks, samples, total_words;
+    Layout(std::uint64_t n, std::uint64_t sample_rate) {
+      std::uint64_t rows = n + 1;
+      this->blocks = (rows + ROWS_PER_BLOCK - 1) / ROWS_PER_BLOCK;
+      this->mark_words = (rows + 63) / 64;
+      this->bwt = HEADER_WORDS;
+      this->occ = this->bwt + (rows + 31) / 32;
+      this->marks = this->occ + 4 * (this->blocks + 1);
+      this->mark_ranks = this->marks + this->mark_words;
+      this->samples = this->mark_ranks + this->mark_words;
+      this->total_words = this->samples + n / sample_rate + 1;
+    }
+  };
+
+  FmIndex() = default;
+
+  static std::uint8_t code(char nucleotide) {
+    switch (nucleotide) {
+      case 'A': return 0;
+      case 'C': return 1;
+      case 'G': return 2;
+      case 'T': return 3;
+      default: return 0xFF;
+    }
+  }
+
+  // Sorts the suffixes of nucleotides + '$' by prefix doubling, radix-sorting rank pairs each round
+  static std::vector<std::uint64_t> suffix_array(std::string_view nucleotides) {
+    std::uint64_t rows = nucleotides.size() + 1;
+    std::vector<std::uint64_t> sa(rows), rank(rows), next_rank(rows), by_second(rows);
+    for (std::uint64_t i = 0; i < rows; ++i) {
+      sa[i] = i;
+      rank[i] = i + 1 < rows ? code(nucleotides[i]) + 1 : 0;  // '$' sorts first
+    }
+    std::uint64_t num_ranks = 5;
+    std::vector<std::uint64_t> bucket;
+    auto sort_by_rank = [&](const std::vector<std::uint64_t> &order) {
+      bucket.assign(num_ranks + 1, 0);
+      for (std::uint64_t i : order)
+        ++bucket[rank[i] + 1];
+      for (std::uint64_t r = 1; r <= num_ranks; ++r)
+        bucket[r] += bucket[r - 1];
+      for (std::uint64_t i : order)
+        sa[bucket[rank[i]]++] = i;
+    };
+    sort_by_rank(std::vector<std::uint64_t>(sa));
+    for (std::uint64_t k = 1;; k *= 2) {
+      // Order by second key (rank at i + k): suffixes with no second half come first
+      std::uint64_t filled = 0;
+      for (std::uint64_t i = rows - std::min(k, rows); i < rows; ++i)
+        by_second[filled++] = i;
+      for (std::uint64_t i : sa) {
+        if (i >= k)
+          by_second[filled++] = i - k;
+      }
+      sort_by_rank(by_second);  // stable, so ties on the first key stay ordered by the second
+      next_rank[sa[0]] = 0;
+      for (std::uint64_t j = 1; j < rows; ++j) {
+        std::uint64_t a = sa[j - 1], b = sa[j];
+        bool same = rank[a] == rank[b] &&
+                    (a + k < rows ? rank[a + k] + 1 : 0) == (b + k < rows ? rank[b + k] + 1 : 0);
+        next_rank[b] = next_rank[a] + !same;
+      }
+      rank.swap(next_rank);
+      num_ranks = rank[sa[rows - 1]] + 1;
+      if (num_ranks == rows)
+        return sa;
+    }
+  }
+
+  // Points the index's arrays into a word array laid out as described by Layout
+  void bind(const std::uint64_t *words) {
+    this->words_ = words;
+    this->size_ = words[1];
+    this->dollar_row_ = words[2];
+    this->sample_rate_ = words[3];
+    std::copy(words + 4, words + 8, this->first_row_.begin());
+    Layout layout(this->size_, this->sample_rate_);
+    this->bwt_ = words + layout.bwt;
+    this->occ_ = words + layout.occ;
+    this->marks_ = words + layout.marks;
+    this->mark_ranks_ = words + layout.mark_ranks;
+    this->samples_ = words + layout.samples;
+  }
+
+  // Returns the number of occurrences of code c in BWT rows [0, row)
+  std::uint64_t occ(std::uint64_t c, std::uint64_t row) const {
+    std::uint64_t block_start = row / ROWS_PER_BLOCK * ROWS_PER_BLOCK;
+    std::uint64_t total = this->occ_[4 * (row / ROWS_PER_BLOCK) + c];
+    std::uint64_t repeated = c * LOW_BITS;  // c in every 2-bit slot
+    for (std::uint64_t pos = block_start; pos < row; pos += 32) {
+      std::uint64_t diff = this->bwt_[pos / 32] ^ repeated;
+      std::uint64_t matches = ~(diff | (diff >> 1)) & LOW_BITS;
+      if (row - pos < 32)
+        matches &= (std::uint64_t{1} << (2 * (row - pos))) - 1;
+      total += __builtin_popcountll(matches);
+    }
+    if (c == 0 && this->dollar_row_ >= block_start && this->dollar_row_ < row)
+      --total;  // the '$' is stored as an 'A'
+    return total;
+  }
+
+  // LF mapping: the row of the suffix starting one position earlier than the suffix at row
+  std::uint64_t lf(std::uint64_t row) const {
+    std::uint64_t c = (this->bwt_[row / 32] >> (2 * (row % 32))) & 3;
+    return this->first_row_[c] + this->occ(c, row);
+  }
+
+  // Returns the number of sampled rows before row
+  std::uint64_t mark_rank(std::uint64_t row) const {
+    std::uint64_t below = (std::uint64_t{1} << (row % 64)) - 1;
+    return this->mark_ranks_[row / 64] + __builtin_popcountll(this->marks_[row / 64] & below);
+  }
+
+  // Backward search: returns the half-open range of rows whose suffixes start with pattern
+  std::pair<std::uint64_t, std::uint64_t> rows_matching(std::string_view pattern) const {
+    std::uint64_t first = 0, last = this->size_ + 1;
+    for (std::size_t i = pattern.size(); i-- > 0 && first < last;) {
+      std::uint64_t c = code(pattern[i]);
+      if (c > 3)
+        return {0, 0};
+      first = this->first_row_[c] + this->occ(c, first);
+      last = this->first_row_[c] + this->occ(c, last);
+    }
+    return {first, std::max(first, last)};
+  }
+
+  std::vector<std::uint64_t> storage_;   // the index, when built in memory
+  std::unique_ptr<MappedFile> mapping_;  // the index, when loaded from disk
+  const std::uint64_t *words_ = nullptr;
+  std::uint64_t size_ = 0, dollar_row_ = 0, sample_rate_ = 1;
+  std::array<std::uint64_t, 4> first_row_{};  // C[c]: the first row whose suffix starts with c
+  const std::uint64_t *bwt_ = nullptr, *occ_ = nullptr, *marks_ = nullptr, *mark_ranks_ = nullptr,
+                      *samples_ = nullptr;
+};
+
+}  // namespace cs19
+
+#endif  // _CS19_FM_INDEX_H
@@ -0,0 +1,242 @@
+/**
+ * @file cs19_nucleotide_kernels.h
+ *
+ * Vectorized counting kernels behind the analytics of cs19::Polynucleotide and cs19::Dna.
+ *
+ * Each kernel has a portable scalar version plus SSE2 and AVX2 versions on x86-64. The widest
+ * version supported by the running CPU is selected once, at first use.
+ */
+#ifndef _CS19_NUCLEOTIDE_KERNELS_H
+#define _CS19_NUCLEOTIDE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CS19_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cs19 {
+namespace kernels {
+
+/**
+ * Instruction sets for which kernels are available.
+ */
+enum class Isa { SCALAR, SSE2, AVX2 };
+
+/**
+ * A set of kernel implementations for one instruction set.
+ */
+struct KernelSet {
+  Isa isa;
+  /** Counts the chars in data[0, count) equal to either c1 or c2 (pass c1 twice to count one). */
+  std::size_t (*count_either)(const char *data, std::size_t count, char c1, char c2);
+  /** Counts the positions in [0, count) where a and b differ. */
+  std::size_t (*count_mismatches)(const char *a, const char *b, std::size_t count);
+  /** Counts occurrences of each of four target chars in data[0, count) into totals[0..3]. */
+  void (*count_each4)(const char *data, std::size_t count, const char targets[4],
+                      std::size_t totals[4]);
+};
+
+namespace scalar {
+
+inline std::size_t count_either(const char *data, std::size_t count, char c1, char c2) {
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < count; ++i)
+    total += (data[i] == c1) | (data[i] == c2);
+  return total;
+}
+
+inline std::size_t count_mismatches(const char *a, const char *b, std::size_t count) {
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < count; ++i)
+    total += a[i] != b[i];
+  return total;
+}
+
+inline void count_each4(const char *data, std::size_t count, const char targets[4],
+                        std::size_t totals[4]) {
+  for (int t = 0; t < 4; ++t)
+    totals[t] = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    for (int t = 0; t < 4; ++t)
+      totals[t] += data[i] == targets[t];
+  }
+}
+
+}  // namespace scalar
+
+#ifdef CS19_KERNELS_X86
+
+// The vector kernels all follow one pattern: each comparison yields 0xFF (i.e. -1) per matching
+// byte, which is subtracted from a vector of 8-bit counters. Before those counters can overflow
+// (255 iterations), they are summed horizontally into 64-bit totals with a SAD against zero.
+
+namespace sse2 {
+
+constexpr std::size_t WIDTH = 16, FLUSH = 255 * WIDTH;
+
+inline std::size_t horizontal_sum(__m128i counters) {
+  __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+  return static_cast<std::size_t>(_mm_cvtsi128_si64(sums)) +
+         static_cast<std::size_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums)));
+}
+
+inline std::size_t count_either(const char *data, std::size_t count, char c1, char c2) {
+  const __m128i v1 = _mm_set1_epi8(c1), v2 = _mm_set1_epi8(c2);
+  std::size_t total = 0, pos = 0;
+  while (pos + WIDTH <= count) {
+    std::size_t end = pos + FLUSH < count ? pos + FLUSH : count;
+    __m128i counters = _mm_setzero_si128();
+    for (; pos + WIDTH <= end; pos += WIDTH) {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+      __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, v1), _mm_cmpeq_epi8(chunk, v2));
+      counters = _mm_sub_epi8(counters, hits);
+    }
+    total += horizontal_sum(counters);
+  }
+  return total + scalar::count_either(data + pos, count - pos, c1, c2);
+}
+
+inline std::size_t count_mismatches(const char *a, const char *b, std::size_t count) {
+  std::size_t matches = 0, pos = 0;
+  while (pos + WIDTH <= count) {
+    std::size_t end = pos + FLUSH < count ? pos + FLUSH : count;
+    __m128i counters = _mm_setzero_si128();
+    for (; pos + WIDTH <= end; pos += WIDTH) {
+      __m128i chunk_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + pos));
+      __m128i chunk_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + pos));
+      counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(chunk_a, chunk_b));
+    }
+    matches += horizontal_sum(counters);
+  }
+  return pos - matches + scalar::count_mismatches(a + pos, b + pos, count - pos);
+}
+
+inline void count_each4(const char *data, std::size_t count, const char targets[4],
+                        std::size_t totals[4]) {
+  __m128i v[4];
+  for (int t = 0; t < 4; ++t)
+    v[t] = _mm_set1_epi8(targets[t]);
+  std::size_t sums[4] = {0, 0, 0, 0}, pos = 0;
+  while (pos + WIDTH <= count) {
+    std::size_t end = pos + FLUSH < count ? pos + FLUSH : count;
+    __m128i counters[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(),
+                           _mm_setzero_si128()};
+    for (; pos + WIDTH <= end; pos += WIDTH) {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+      for (int t = 0; t < 4; ++t)
+        counters[t] = _mm_sub_epi8(counters[t], _mm_cmpeq_epi8(chunk, v[t]));
+    }
+    for (int t = 0; t < 4; ++t)
+      sums[t] += horizontal_sum(counters[t]);
+  }
+  scalar::count_each4(data + pos, count - pos, targets, totals);
+  for (int t = 0; t < 4; ++t)
+    totals[t] += sums[t];
+}
+
+}  // namespace sse2
+
+namespace avx2 {
+
+constexpr std::size_t WIDTH = 32, FLUSH = 255 * WIDTH;
+
+__attribute__((target("avx2"))) inline std::size_t horizontal_sum(__m256i counters) {
+  __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+  return static_cast<std::size_t>(_mm256_extract_epi64(sums, 0)) +
+         static_cast<std::size_t>(_mm256_extract_epi64(sums, 1)) +
+         static_cast<std::size_t>(_mm256_extract_epi64(sums, 2)) +
+         static_cast<std::size_t>(_mm256_extract_epi64(sums, 3));
+}
+
+__attribute__((target("avx2"))) inline std::size_t count_either(const char *data,
+                                                                std::size_t count, char c1,
+                                                                char c2) {
+  const __m256i v1 = _mm256_set1_epi8(c1), v2 = _mm256_set1_epi8(c2);
+  std::size_t total = 0, pos = 0;
+  while (pos + WIDTH <= count) {
+    std::size_t end = pos + FLUSH < count ? pos + FLUSH : count;
+    __m256i counters = _mm256_setzero_si256();
+    for (; pos + WIDTH <= end; pos += WIDTH) {
+      __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+      __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, v1), _mm256_cmpeq_epi8(chunk, v2));
+      counters = _mm256_sub_epi8(counters, hits);
+    }
+    total += horizontal_sum(counters);
+  }
+  return total + sse2::count_either(data + pos, count - pos, c1, c2);
+}
+
+__attribute__((target("avx2"))) inline std::size_t count_mismatches(const char *a, const char *b,
+                                                                    std::size_t count) {
+  std::size_t matches = 0, pos = 0;
+  while (pos + WIDTH <= count) {
+    std::size_t end = pos + FLUSH < count ? pos + FLUSH : count;
+    __m256i counters = _mm256_setzero_si256();
+    for (; pos + WIDTH <= end; pos += WIDTH) {
+      __m256i chunk_a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + pos));
+      __m256i chunk_b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + pos));
+      counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(chunk_a, chunk_b));
+    }
+    matches += horizontal_sum(counters);
+  }
+  return pos - matches + sse2::count_mismatches(a + pos, b + pos, count - pos);
+}
+
+__attribute__((target("avx2"))) inline void count_each4(const char *data, std::size_t count,
+                                                        const char targets[4],
+                                                        std::size_t totals[4]) {
+  __m256i v[4];
+  for (int t = 0; t < 4; ++t)
+    v[t] = _mm256_set1_epi8(targets[t]);
+  std::size_t sums[4] = {0, 0, 0, 0}, pos = 0;
+  while (pos + WIDTH <= count) {
+    std::size_t end = pos + FLUSH < count ? pos + FLUSH : count;
+    __m256i counters[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(),
+                           _mm256_setzero_si256()};
+    for (; pos + WIDTH <= end; pos += WIDTH) {
+      __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+      for (int t = 0; t < 4; ++t)
+        counters[t] = _mm256_sub_epi8(counters[t], _mm256_cmpeq_epi8(chunk, v[t]));
+    }
+    for (int t = 0; t < 4; ++t)
+      sums[t] += horizontal_sum(counters[t]);
+  }
+  sse2::count_each4(data + pos, count - pos, targets, totals);
+  for (int t = 0; t < 4; ++t)
+    totals[t] += sums[t];
+}
+
+}  // namespace avx2
+
+#endif  // CS19_KERNELS_X86
+
+/**
+ * Returns the kernels for a given instruction set, or the scalar kernels if that instruction set is
+ * unavailable on this platform or CPU.
+ */
+inline KernelSet kernels_for(Isa isa) {
+#ifdef CS19_KERNELS_X86
+  if (isa == Isa::AVX2 && __builtin_cpu_supports("avx2"))
+    return {Isa::AVX2, avx2::count_either, avx2::count_mismatches, avx2::count_each4};
+  if (isa != Isa::SCALAR)
+    return {Isa::SSE2, sse2::count_either, sse2::count_mismatches, sse2::count_each4};
+#endif
+  (void)isa;
+  return {Isa::SCALAR, scalar::count_either, scalar::count_mismatches, scalar::count_each4};
+}
+
+/**
+ * Returns the fastest kernels supported by the running CPU, chosen once on first use.
+ */
+inline const KernelSet &active() {
+  static const KernelSet best = kernels_for(Isa::AVX2);
+  return best;
+}
+
+}  // namespace kernels
+}  // namespace cs19
+
+#endif  // _CS19_NUCLEOTIDE_KERNELS_H
@@ -0,0 +1,315 @@
+/**
+ * @file cs19_packed_dna.h
+ *
+ * A compact alternative backing store for DNA sequences, storing each nucleotide in 2 bits rather
+ * than a full char. Useful for genome-scale sequences that would not fit in memory as a cs19::Dna.
+ */
+#ifndef _CS19_PACKED_DNA_H
+#define _CS19_PACKED_DNA_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cs19_dna.h"
+
+namespace cs19 {
+
+/**
+ * Class PackedDna models a mutable DNA sequence stored at 2 bits per nucleotide, 32 nucleotides per
+ * 64-bit word. Nucleotides are encoded as A=0, C=1, G=2, T=3, so that the complement of any code is
+ * simply its bitwise negation, and analytics can operate a whole word at a time.
+ *
+ * Element access, to_string() and stream insertion behave exactly as they do for cs19::Dna.
+ */
+class PackedDna {
+ public:
+  static constexpr std::size_t BASES_PER_WORD = 32;
+
+  /**
+   * Default constructor: Creates an empty sequence.
+   */
+  PackedDna() = default;
+
+  /**
+   * C string contructor: Works with any C string containing valid DNA characters.
+   * @throws std::domain_error for any string containing invalid DNA characters.
+   */
+  PackedDna(const char *contents) {
+    this->operator+=(contents);
+  }
+
+  /**
+   * String contructor: Works with any string containing valid DNA characters.
+   * @throws std::domain_error for any string containing invalid DNA characters.
+   */
+  PackedDna(const std::string &contents) {
+    this->operator+=(contents);
+  }
+
+  /**
+   * Conversion constructor: Packs the contents of an existing DNA sequence.
+   */
+  explicit PackedDna(const Dna &dna) {
+    this->append(dna.view().data(), dna.size());
+  }
+
+  /**
+   * Compound addition/assignment: Appends valid DNA characters from a string to this sequence.
+   * @throws std::domain_error if the appendage contains invalid characters
+   */
+  PackedDna &operator+=(const std::string &appendage) {
+    this->append(appendage.data(), appendage.size());
+    return *this;
+  }
+
+  /**
+   * Compound addition/assignment: Appends valid DNA characters from a C string to this sequence.
+   * @throws std::domain_error if the appendage contains invalid characters
+   */
+  PackedDna &operator+=(const char *appendage) {
+    this->append(appendage, std::char_traits<char>::length(appendage));
+    return *this;
+  }
+
+  /**
+   * Compound addition/assignment: Appends one nucleotide character to this sequence.
+   * @throws std::domain_error if nucleotide is an invalid character
+   */
+  PackedDna &operator+=(char nucleotide) {
+    this->append(&nucleotide, 1);
+    return *this;
+  }
+
+  /**
+   * const subscript: Returns the nucleotide at the given position.
+   */
+  char operator[](std::size_t pos) const {
+    return DECODE[this->code(pos)];
+  }
+
+  /**
+   * Complement operator: Returns this sequence's complementary sequence.
+   */
+  PackedDna operator~() const {
+    PackedDna complement(*this);
+    for (auto &word : complement.words_)
+      word = ~word;
+    complement.mask_tail();
+    return complement;
+  }
+
+  /**
+   * Unary minus operator: Returns this sequence in reverse.
+   */
+  PackedDna operator-() const {
+    PackedDna reversed;
+    reversed.size_ = this->size_;
+    std::size_t num_words = this->words_.size();
+    reversed.words_.resize(num_words);
+    // Reversing every word and the order of the words reverses the zero-padded sequence...
+    for (std::size_t i = 0; i < num_words; ++i)
+      reversed.words_[num_words - 1 - i] = reverse_word(this->words_[i]);
+    // ...after which the padding sits at the front and must be shifted out.
+    std::size_t pad_bits = 2 * (num_words * BASES_PER_WORD - this->size_);
+    if (pad_bits) {
+      for (std::size_t i = 0; i < num_words; ++i) {
+        std::uint64_t next = i + 1 < num_words ? reversed.words_[i + 1] : 0;
+        reversed.words_[i] = (reversed.words_[i] >> pad_bits) | (next << (64 - pad_bits));
+      }
+    }
+    return reversed;
+  }
+
+  /**
+   * Logical equality: Two PackedDna objects compare equal if they contain the same nucleotides.
+   */
+  bool operator==(const PackedDna &that) const {
+    return this->size_ == that.size_ && this->words_ == that.words_;
+  }
+
+  bool operator!=(const PackedDna &that) const {
+    return !(*this == that);
+  }
+
+  /**
+   * Stream insertion operator: object will appear as a plain string sequence, e.g. "GATTACA".
+   */
+  friend std::ostream &operator<<(std::ostream &out, const PackedDna &dna) {
+    char buffer[BASES_PER_WORD * 64];
+    for (std::size_t pos = 0; pos < dna.size_; pos += sizeof buffer) {
+      std::size_t count = std::min(sizeof buffer, dna.size_ - pos);
+      dna.unpack(pos, count, buffer);
+      out.write(buffer, count);
+    }
+    return out;
+  }
+
+  /**
+   * Removes all elements from this sequence, resulting in an empty sequence.
+   */
+  void clear() {
+    this->words_.clear();
+    this->size_ = 0;
+  }
+
+  /**
+   * Returns a string containing this sequence's nucleotides.
+   */
+  std::string to_string() const {
+    std::string unpacked(this->size_, '\0');
+    this->unpack(0, this->size_, unpacked.data());
+    return unpacked;
+  }
+
+  /**
+   * Returns an unpacked cs19::Dna object containing this sequence's nucleotides.
+   */
+  Dna to_dna() const {
+    return Dna(this->to_string());
+  }
+
+  /**
+   * Returns the length of this sequence.
+   */
+  std::size_t size() const {
+    return this->size_;
+  }
+
+  /**
+   * Sets the value of the nucleotide at the given position to the given value.
+   * @throws std::domain_error if nucleotide is an invalid character
+   */
+  void set(std::size_t pos, char nucleotide) {
+    std::uint8_t code = ENCODE[static_cast<unsigned char>(nucleotide)];
+    if (code == INVALID)
+      throw std::domain_error("Invalid Character");
+    std::uint64_t &word = this->words_[pos / BASES_PER_WORD];
+    unsigned shift = 2 * (pos % BASES_PER_WORD);
+    word = (word & ~(std::uint64_t{3} << shift)) | (std::uint64_t{code} << shift);
+  }
+
+  /**
+   * Computes the Hamming distance between this sequence and another, one word at a time.
+   * @throws std::domain_error if the two sequences are of unequal length
+   */
+  int hamming_distance(const PackedDna &that) const {
+    if (this->size_ != that.size_)
+      throw std::domain_error("String sizes not equal");
+    int distance = 0;
+    for (std::size_t i = 0; i < this->words_.size(); ++i)
+      distance += __builtin_popcountll(differing_bases(this->words_[i], that.words_[i]));
+    return distance;
+  }
+
+  /**
+   * Returns a mapping of each unique nucleotide in the sequence to its frequency in the sequence.
+   */
+  std::map<char, int> nucleotide_counts() const {
+    std::size_t c_count = 0, g_count = 0, t_count = 0;
+    for (std::uint64_t word : this->words_) {
+      std::uint64_t low = word & LOW_BITS, high = (word >> 1) & LOW_BITS;
+      c_count += __builtin_popcountll(low & ~high);
+      g_count += __builtin_popcountll(high & ~low);
+      t_count += __builtin_popcountll(low & high);
+    }
+    // Padding bits are zero, i.e. encoded as 'A', so A is whatever remains.
+    std::size_t a_count = this->size_ - c_count - g_count - t_count;
+    std::map<char, int> counts;
+    for (auto [nucleotide, count] : {std::pair{'A', a_count}, std::pair{'C', c_count},
+                                     std::pair{'G', g_count}, std::pair{'T', t_count}}) {
+      if (count)
+        counts[nucleotide] = static_cast<int>(count);
+    }
+    return counts;
+  }
+
+  /**
+   * Returns the GC-content of this sequence.
+   */
+  double gc_content() const {
+    if (this->size_ == 0)
+      return 0;
+    std::size_t gc_count = 0;
+    for (std::uint64_t word : this->words_)  // C and G are exactly the codes with unequal bits
+      gc_count += __builtin_popcountll((word ^ (word >> 1)) & LOW_BITS);
+    return static_cast<double>(gc_count) / this->size_;
+  }
+
+  /**
+   * Returns the packed representation: nucleotide i occupies bits [2*(i%32), 2*(i%32)+1] of word
+   * i/32. Bits beyond size() are always zero.
+   */
+  const std::vector<std::uint64_t> &words() const {
+    return this->words_;
+  }
+
+ private:
+  static constexpr std::uint8_t INVALID = 0xFF;
+  static constexpr std::uint64_t LOW_BITS = 0x5555555555555555;  // low bit of every 2-bit code
+  static constexpr char DECODE[4] = {'A', 'C', 'G', 'T'};
+  static constexpr std::array<std::uint8_t, 256> ENCODE = [] {
+    std::array<std::uint8_t, 256> table{};
+    for (auto &code : table)
+      code = INVALID;
+    for (std::uint8_t code = 0; code < 4; ++code)
+      table[static_cast<unsigned char>(DECODE[code])] = code;
+    return table;
+  }();
+
+  // Returns a word with the low bit of each 2-bit slot set where the two words' nucleotides differ
+  static std::uint64_t differing_bases(std::uint64_t a, std::uint64_t b) {
+    std::uint64_t diff = a ^ b;
+    return (diff | (diff >> 1)) & LOW_BITS;
+  }
+
+  // Reverses the order of the 32 2-bit codes in a word
+  static std::uint64_t reverse_word(std::uint64_t word) {
+    word = ((word >> 2) & 0x3333333333333333) | ((word & 0x3333333333333333) << 2);
+    word = ((word >> 4) & 0x0F0F0F0F0F0F0F0F) | ((word & 0x0F0F0F0F0F0F0F0F) << 4);
+    return __builtin_bswap64(word);
+  }
+
+  std::uint8_t code(std::size_t pos) const {
+    return (this->words_[pos / BASES_PER_WORD] >> (2 * (pos % BASES_PER_WORD))) & 3;
+  }
+
+  // Clears any bits beyond the end of the sequence in the final word
+  void mask_tail() {
+    std::size_t used = this->size_ % BASES_PER_WORD;
+    if (used)
+      this->words_.back() &= (std::uint64_t{1} << (2 * used)) - 1;
+  }
+
+  // Validates a buffer of nucleotide characters in its entirety, then packs it onto the end
+  void append(const char *nucleotides, std::size_t count) {
+    std::uint8_t invalid = 0;
+    for (std::size_t i = 0; i < count; ++i)
+      invalid |= ENCODE[static_cast<unsigned char>(nucleotides[i])] & 0x80;
+    if (invalid)
+      throw std::domain_error("Invalid Character");
+    this->words_.resize((this->size_ + count + BASES_PER_WORD - 1) / BASES_PER_WORD);
+    for (std::size_t i = 0; i < count; ++i, ++this->size_) {
+      std::uint64_t code = ENCODE[static_cast<unsigned char>(nucleotides[i])];
+      this->words_[this->size_ / BASES_PER_WORD] |= code << (2 * (this->size_ % BASES_PER_WORD));
+    }
+  }
+
+  // Decodes count nucleotides starting at pos into a char buffer
+  void unpack(std::size_t pos, std::size_t count, char *out) const {
+    for (std::size_t i = 0; i < count; ++i)
+      out[i] = DECODE[this->code(pos + i)];
+  }
+
+  std::vector<std::uint64_t> words_;  // 2-bit codes, 32 per word, unused high bits kept at zero
+  std::size_t size_ = 0;              // number of nucleotides stored
+};
+
+}  // namespace cs19
+
+#endif  // _CS19_PACKED_DNA_H
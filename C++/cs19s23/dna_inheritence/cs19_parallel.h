@@ -0,0 +1,99 @@
+/**
+ * @file cs19_parallel.h
+ *
+ * A minimal execution policy for splitting work on large sequences across threads, used by the
+ * parallel overloads of cs19::Polynucleotide and cs19::Dna analytics. Link with -pthread.
+ */
+#ifndef _CS19_PARALLEL_H
+#define _CS19_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace cs19 {
+
+/**
+ * Struct ParallelPolicy describes how to split a range of work into contiguous chunks, each
+ * processed on its own thread. Results are always merged in chunk order, so they are deterministic
+ * and identical to the serial results.
+ */
+struct ParallelPolicy {
+  unsigned threads = 0;              // maximum number of threads; 0 means one per hardware thread
+  std::size_t min_chunk = 1 << 20;   // never split the work into chunks smaller than this
+
+  /**
+   * Returns the number of chunks to split count elements into: at least 1.
+   */
+  std::size_t chunks_for(std::size_t count) const {
+    std::size_t max_threads = this->threads ? this->threads : std::thread::hardware_concurrency();
+    std::size_t by_size = (count + this->min_chunk - 1) / std::max<std::size_t>(this->min_chunk, 1);
+    return std::max<std::size_t>(1, std::min(std::max<std::size_t>(max_threads, 1), by_size));
+  }
+};
+
+/**
+ * The default parallel policy, e.g. dna.gc_content(cs19::par).
+ */
+inline constexpr ParallelPolicy par{};
+
+namespace parallel {
+
+/**
+ * Splits [0, count) into contiguous chunks of near-equal size and calls fn(chunk, begin, end) for
+ * each, concurrently. The calling thread processes chunk 0, and any chunks that no thread could be
+ * started for. If any call throws, the exception from the lowest-numbered failing chunk is
+ * rethrown once all threads have finished.
+ *
+ * @return the number of chunks
+ */
+template <typename Function>
+std::size_t for_each_chunk(std::size_t count, const ParallelPolicy &policy, Function fn) {
+  std::size_t chunks = policy.chunks_for(count);
+  std::vector<std::exception_ptr> errors(chunks);
+  auto run = [&](std::size_t chunk) {
+    try {
+      fn(chunk, count * chunk / chunks, count * (chunk + 1) / chunks);
+    } catch (...) {
+      errors[chunk] = std::current_exception();
+    }
+  };
+  std::vector<std::thread> workers;
+  workers.reserve(chunks - 1);
+  std::size_t spawned = 1;
+  try {
+    for (; spawned < chunks; ++spawned)
+      workers.emplace_back(run, spawned);
+  } catch (...) {
+    // Out of threads: the started workers must still be joined, so finish the rest here instead
+  }
+  run(0);
+  for (std::size_t chunk = spawned; chunk < chunks; ++chunk)
+    run(chunk);
+  for (auto &worker : workers)
+    worker.join();
+  for (const auto &error : errors) {
+    if (error)
+      std::rethrow_exception(error);
+  }
+  return chunks;
+}
+
+/**
+ * Like for_each_chunk, but collects fn(begin, end) for each chunk into a vector, in chunk order.
+ */
+template <typename Result, typename Function>
+std::vector<Result> map_chunks(std::size_t count, const ParallelPolicy &policy, Function fn) {
+  std::vector<Result> results(policy.chunks_for(count));
+  for_each_chunk(count, policy, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+    results[chunk] = fn(begin, end);
+  });
+  return results;
+}
+
+}  // namespace parallel
+}  // namespace cs19
+
+#endif  // _CS19_PARALLEL_H
@@ -10,15 +10,298 @@
 #ifndef _CS19_POLYNUCLEOTIDE_H
 #define _CS19_POLYNUCLEOTIDE_H
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <utility>
+#include <vector>
+
+#include "cs19_nucleotide_kernels.h"
+#include "cs19_parallel.h"
 
 namespace cs19 {
 
+/**
+ * Class ComplementTable maps every possible char to its complementary nucleotide, or to '\0' for
+ * characters that are not valid nucleotides. Lookups are a single array index rather than a tree
+ * walk, and tables for fixed alphabets (e.g. DNA) can be built at compile time.
+ */
+class ComplementTable {
+ public:
+  /**
+   * Default constructor: Creates a table in which no character is a valid nucleotide.
+   */
+  constexpr ComplementTable() : table_{} {}
+
+  /**
+   * Initializer-list constructor: Creates a table from nucleotide/complement pairs.
+   * e.g. constexpr cs19::ComplementTable rna{{'A', 'U'}, {'U', 'A'}, {'C', 'G'}, {'G', 'C'}};
+   */
+  constexpr ComplementTable(std::initializer_list<std::pair<char, char>> complements) : table_{} {
+    for (const auto &pair : complements)
+      this->table_[static_cast<unsigned char>(pair.first)] = pair.second;
+  }
+
+  /**
+   * Map constructor: Creates a table from a mapping of valid nucleotides to their complements.
+   */
+  ComplementTable(const std::map<char, char> &complements) : table_{} {
+    for (const auto &[nucleotide, complement] : complements)
+      this->table_[static_cast<unsigned char>(nucleotide)] = complement;
+  }
+
+  /**
+   * Returns the complement of the given nucleotide, or '\0' if it is not a valid nucleotide.
+   */
+  constexpr char operator[](char nucleotide) const {
+    return this->table_[static_cast<unsigned char>(nucleotide)];
+  }
+
+  /**
+   * Returns whether the given character is a valid nucleotide.
+   */
+  constexpr bool is_valid(char nucleotide) const {
+    return this->operator[](nucleotide) != '\0';
+  }
+
+  /**
+   * Returns the position of the first invalid nucleotide in a buffer, or count if all are valid.
+   * Validity is accumulated without branching over fixed-size blocks, so the common all-valid case
+   * runs at close to memory bandwidth.
+   */
+  std::size_t find_invalid(const char *nucleotides, std::size_t count) const {
+    constexpr std::size_t BLOCK_SIZE = 64;
+    std::size_t pos = 0;
+    for (; pos + BLOCK_SIZE <= count; pos += BLOCK_SIZE) {
+      bool block_valid = true;
+      for (std::size_t i = pos; i < pos + BLOCK_SIZE; ++i)
+        block_valid &= this->is_valid(nucleotides[i]);
+      if (!block_valid)
+        break;
+    }
+    for (; pos < count; ++pos) {
+      if (!this->is_valid(nucleotides[pos]))
+        return pos;
+    }
+    return count;
+  }
+
+  /**
+   * Returns a string containing every valid nucleotide, in increasing order of char value.
+   */
+  std::string nucleotides() const {
+    std::string valid;
+    for (int c = 0; c < 256; ++c) {
+      if (this->table_[c])
+        valid += static_cast<char>(c);
+    }
+    return valid;
+  }
+
+  bool operator==(const ComplementTable &that) const {
+    return this->table_ == that.table_;
+  }
+
+  bool operator!=(const ComplementTable &that) const {
+    return !(*this == that);
+  }
+
+ private:
+  std::array<char, 256> table_;  // indexed by unsigned char value
+};
+
+/**
+ * Class NucleotideView is a lazy, non-owning view of a nucleotide sequence that may present it
+ * reversed and/or complemented without allocating. Each element is computed on access.
+ *
+ * A view is only valid while the sequence (and complement table) it refers to is unmodified.
+ */
+class NucleotideView {
+ public:
+  /**
+   * A random-access iterator over the (possibly reversed and complemented) nucleotides of a view.
+   * It holds what it needs of the view itself, so it stays valid after a temporary view is gone.
+   */
+  class const_iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = char;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = char;
+
+    const_iterator() = default;
+
+    char operator*() const {
+      return this->at(this->pos_);
+    }
+    char operator[](difference_type offset) const {
+      return this->at(this->pos_ + offset);
+    }
+    const_iterator &operator++() {
+      ++this->pos_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator previous = *this;
+      ++this->pos_;
+      return previous;
+    }
+    const_iterator &operator--() {
+      --this->pos_;
+      return *this;
+    }
+    const_iterator operator--(int) {
+      const_iterator previous = *this;
+      --this->pos_;
+      return previous;
+    }
+    const_iterator &operator+=(difference_type offset) {
+      this->pos_ += offset;
+      return *this;
+    }
+    const_iterator &operator-=(difference_type offset) {
+      this->pos_ -= offset;
+      return *this;
+    }
+    const_iterator operator+(difference_type offset) const {
+      const_iterator moved = *this;
+      return moved += offset;
+    }
+    friend const_iterator operator+(difference_type offset, const const_iterator &it) {
+      return it + offset;
+    }
+    const_iterator operator-(difference_type offset) const {
+      const_iterator moved = *this;
+      return moved -= offset;
+    }
+    difference_type operator-(const const_iterator &that) const {
+      return static_cast<difference_type>(this->pos_) - static_cast<difference_type>(that.pos_);
+    }
+    bool operator==(const const_iterator &that) const {
+      return this->pos_ == that.pos_;
+    }
+    bool operator!=(const const_iterator &that) const {
+      return this->pos_ != that.pos_;
+    }
+    bool operator<(const const_iterator &that) const {
+      return this->pos_ < that.pos_;
+    }
+    bool operator>(const const_iterator &that) const {
+      return this->pos_ > that.pos_;
+    }
+    bool operator<=(const const_iterator &that) const {
+      return this->pos_ <= that.pos_;
+    }
+    bool operator>=(const const_iterator &that) const {
+      return this->pos_ >= that.pos_;
+    }
+
+   private:
+    friend class NucleotideView;
+
+    const_iterator(const NucleotideView &view, std::size_t pos)
+        : nucleotides_(view.nucleotides_.data()),
+          size_(view.nucleotides_.size()),
+          complements_(view.complements_),
+          reversed_(view.reversed_),
+          complemented_(view.complemented_),
+          pos_(pos) {}
+
+    char at(std::size_t pos) const {
+      char nucleotide = this->nucleotides_[this->reversed_ ? this->size_ - 1 - pos : pos];
+      return this->complemented_ ? (*this->complements_)[nucleotide] : nucleotide;
+    }
+
+    const char *nucleotides_ = nullptr;
+    std::size_t size_ = 0;
+    const ComplementTable *complements_ = nullptr;
+    bool reversed_ = false;
+    bool complemented_ = false;
+    std::size_t pos_ = 0;
+  };
+
+  /**
+   * Creates a view of a sequence of nucleotides.
+   *
+   * @param nucleotides the underlying nucleotides
+   * @param complements the table used to complement nucleotides, if complemented
+   * @param reversed whether the view presents the nucleotides in reverse order
+   * @param complemented whether the view presents the nucleotides' complements
+   */
+  NucleotideView(std::string_view nucleotides, const ComplementTable &complements,
+                 bool reversed = false, bool complemented = false)
+      : nucleotides_(nucleotides),
+        complements_(&complements),
+        reversed_(reversed),
+        complemented_(complemented) {}
+
+  /**
+   * Returns the nucleotide at the given position of the view.
+   */
+  char operator[](std::size_t pos) const {
+    std::size_t index = this->reversed_ ? this->nucleotides_.size() - 1 - pos : pos;
+    char nucleotide = this->nucleotides_[index];
+    return this->complemented_ ? (*this->complements_)[nucleotide] : nucleotide;
+  }
+
+  std::size_t size() const {
+    return this->nucleotides_.size();
+  }
+
+  const_iterator begin() const {
+    return const_iterator(*this, 0);
+  }
+
+  const_iterator end() const {
+    return const_iterator(*this, this->size());
+  }
+
+  /**
+   * Returns a view of the same nucleotides in the opposite order.
+   */
+  NucleotideView reversed() const {
+    return NucleotideView(this->nucleotides_, *this->complements_, !this->reversed_,
+                          this->complemented_);
+  }
+
+  /**
+   * Returns a view of the complements of these nucleotides.
+   */
+  NucleotideView complemented() const {
+    return NucleotideView(this->nucleotides_, *this->complements_, this->reversed_,
+                          !this->complemented_);
+  }
+
+  /**
+   * Returns a view of the reverse complement of these nucleotides.
+   */
+  NucleotideView reverse_complemented() const {
+    return this->reversed().complemented();
+  }
+
+  /**
+   * Returns a string containing the nucleotides as presented by this view.
+   */
+  std::string to_string() const {
+    return std::string(this->begin(), this->end());
+  }
+
+ private:
+  std::string_view nucleotides_;
+  const ComplementTable *complements_;
+  bool reversed_;
+  bool complemented_;
+};
+
 /**
  * Class Polynucleotide models a class representing a mutable nucleic acid sequence, with operators
  * providing an idiomatic C++ interface, meant to serve as a base class for classes modeling
@@ -29,51 +312,49 @@ class Polynucleotide {
   /**
    * Default constructor: Creates an empty sequence.
    *
-   * @param complements a mapping of valid nucleotides to their complementary nucleotides
+   * @param complements a table of valid nucleotides and their complementary nucleotides
    */
-  Polynucleotide(std::map<char, char> complements) {
-    this->complements_ = complements;
-  }
+  Polynucleotide(const ComplementTable &complements) : complements_(complements) {}
 
   /**
    * Copy constructor: Copies from a pre-existing Polynucleotide.
    *
    * @param extant a pre-existing Polynucleotide object
    */
-  Polynucleotide(const Polynucleotide &extant) {
-    this->complements_ = extant.complements_;
-    std::string ext_sequence = extant.to_string();
-    for (const char c : ext_sequence) {
-      this->operator+=(c);
-    }
+  Polynucleotide(const Polynucleotide &extant)
+      : complements_(extant.complements_), sequence_(extant.sequence_) {
+    // the extant sequence's nucleotides are already known to be valid
   }
 
+  /**
+   * Move constructor: Takes over the nucleotides of an expiring Polynucleotide without copying.
+   *
+   * @param expiring a Polynucleotide object whose contents may be taken
+   */
+  Polynucleotide(Polynucleotide &&expiring) noexcept = default;
+
   /**
    * C string contructor: Creates a sequence from a C string containing nucleotide characters.
    *
    * @param contents a C string containing nucleotide characters
-   * @param complements a mapping of valid nucleotides to their complementary nucleotides
+   * @param complements a table of valid nucleotides and their complementary nucleotides
    * @throws std::domain_error for any string containing invalid nucleotide characters
    */
-  Polynucleotide(const char *contents, std::map<char, char> complements) {
-    this->complements_ = complements;
-    for (; *contents; ++contents) {
-      this->operator+=(*contents);
-    }
+  Polynucleotide(const char *contents, const ComplementTable &complements)
+      : complements_(complements) {
+    this->operator+=(contents);
   }
 
   /**
    * Initializer-list constructor: Creates a sequence from an initializer_list of characters.
    *
    * @param list a list of nucleotide characters
-   * @param complements a mapping of valid nucleotides to their complementary nucleotides
+   * @param complements a table of valid nucleotides and their complementary nucleotides
    * @throws std::domain_error if any element in the list is an invalid nucleotide character
    */
-  Polynucleotide(std::initializer_list<char> list, std::map<char, char> complements) {
-    this->complements_ = complements;
-    for (const char& c : list) {
-      this->operator+=(c);
-    }
+  Polynucleotide(std::initializer_list<char> list, const ComplementTable &complements)
+      : complements_(complements) {
+    this->append(list.begin(), list.size());
   }
 
   /**
@@ -81,12 +362,12 @@ class Polynucleotide {
    *
    * @tparam Sequence iterable sequence type containing characters e.g. std::string/std::list<char>
    * @param contents a sequence containing nucleotide characters
-   * @param complements a mapping of valid nucleotides to their complementary nucleotides
+   * @param complements a table of valid nucleotides and their complementary nucleotides
    * @throws std::domain_error for any sequence containing invalid nucleotide characters
    */
   template <typename Sequence>
-  Polynucleotide(const Sequence &contents, std::map<char, char> complements) {
-    this->complements_ = complements;
+  Polynucleotide(const Sequence &contents, const ComplementTable &complements)
+      : complements_(complements) {
     this->operator+=(contents);  // reuse compound assignment/addition function
   }
 
@@ -95,12 +376,12 @@ class Polynucleotide {
    * @tparam Sequence iterable sequence type containing characters e.g. std::string/std::list<char>
    *
    * @param list a list of sequences containing nucleotide characters
-   * @param complements a mapping of valid nucleotides to their complementary nucleotides
+   * @param complements a table of valid nucleotides and their complementary nucleotides
    * @throws std::domain_error for any sequence containing invalid nucleotide characters
    */
   template <typename Sequence>
-  Polynucleotide(std::initializer_list<Sequence> list, std::map<char, char> complements) {
-    this->complements_ = complements;
+  Polynucleotide(std::initializer_list<Sequence> list, const ComplementTable &complements)
+      : complements_(complements) {
     for (Sequence initial_sequence : list)
       this->operator+=(initial_sequence);  // reuse compound assignment/addition function
   }
@@ -112,15 +393,13 @@ class Polynucleotide {
    * @throws std::domain_error if the appendage has a different complement mapping
    */
   Polynucleotide &operator+=(const Polynucleotide &appendage) {
-    std::string app_sequence = appendage.to_string();
-    std::map<char, char> app_comp = appendage.complements_;
-    for (const char& c : app_sequence) {
-      if (app_comp[c] == this->complements_[c]) {
-        this->sequence_ += c;
-      } else {
-        throw std::domain_error("Different Mapping");
+    if (appendage.complements_ != this->complements_) {
+      for (const char c : appendage.sequence_) {
+        if (appendage.complements_[c] != this->complements_[c])
+          throw std::domain_error("Different Mapping");
       }
     }
+    this->sequence_ += appendage.sequence_;  // already validated against an equivalent mapping
     return *this;
   }
 
@@ -131,14 +410,17 @@ class Polynucleotide {
    * @throws std::domain_error if the appendage contains invalid characters
    */
   Polynucleotide &operator+=(const std::string &appendage) {
-    for (const char& c : appendage) {
-      if (this->complements_[c]) {
-        this->sequence_ += c;
-      } else {
-        throw std::domain_error("Invalid Character");
-      }
-    }
-    return *this;
+    return this->append(appendage.data(), appendage.size());
+  }
+
+  /**
+   * Compound addition/assignment:
+   * Appends valid nucleotide characters from a string view to this sequence.
+   * @param appendage the sequence to append
+   * @throws std::domain_error if the appendage contains invalid characters
+   */
+  Polynucleotide &operator+=(std::string_view appendage) {
+    return this->append(appendage.data(), appendage.size());
   }
 
   /**
@@ -148,14 +430,7 @@ class Polynucleotide {
    * @throws std::domain_error if the appendage contains invalid characters
    */
   Polynucleotide &operator+=(const char *appendage) {
-    for (; *appendage; ++appendage) {
-      if (this->complements_[*appendage]) {
-        this->sequence_ += *appendage;
-      } else {
-        throw std::domain_error("Invalid Character");
-      }
-    }
-    return *this;
+    return this->append(appendage, std::char_traits<char>::length(appendage));
   }
 
   /**
@@ -164,7 +439,7 @@ class Polynucleotide {
    * @throws std::domain_error if nucleotide is an invalid character
    */
   Polynucleotide &operator+=(char nucleotide) {
-    if (this->complements_[nucleotide]) {
+    if (this->complements_.is_valid(nucleotide)) {
       this->sequence_ += nucleotide;
       return *this;
     } else {
@@ -172,6 +447,21 @@ class Polynucleotide {
     }
   }
 
+  /**
+   * Bulk append: Validates a whole buffer of nucleotide characters, then appends it in one step.
+   * Nothing is appended if any character is invalid.
+   *
+   * @param nucleotides the characters to append
+   * @param count the number of characters to append
+   * @throws std::domain_error if the buffer contains invalid characters
+   */
+  Polynucleotide &append(const char *nucleotides, std::size_t count) {
+    if (this->complements_.find_invalid(nucleotides, count) != count)
+      throw std::domain_error("Invalid Character");
+    this->sequence_.append(nucleotides, count);
+    return *this;
+  }
+
   /**
    * Compound multiplication/assignment:
    * Repeats/concatenates this sequence a number of times.
@@ -183,9 +473,8 @@ class Polynucleotide {
     if (repeat_count < 0) {
       throw std::domain_error("Repeat count is negative");
     } else {
-      for (int i = 0; i < repeat_count; ++i) {
-        this->sequence_ += this->sequence_;
-      }
+      this->sequence_.reserve(repeated_size(this->sequence_.size(), repeat_count));
+      repeat(this->sequence_, repeat_count);
       return *this;
     }
   }
@@ -200,32 +489,78 @@ class Polynucleotide {
   /**
    * Complement operator: Returns this sequence's complementary sequence.
    */
-  Polynucleotide operator~() const {
+  Polynucleotide operator~() const & {
     cs19::Polynucleotide complement_sequence(this->complements_);
-    std::map<char, char> comp = this->complements_;
-    for (const char c : this->to_string()) {
-      complement_sequence += comp[c];
-    }
+    complement_sequence.sequence_.resize(this->sequence_.size());
+    this->complement_into(this->sequence_.data(), this->sequence_.size(),
+                          complement_sequence.sequence_.data());
     return complement_sequence;
   }
 
+  /**
+   * Complement operator: Complements an expiring sequence in place, reusing its storage.
+   */
+  Polynucleotide operator~() && {
+    this->complement_into(this->sequence_.data(), this->sequence_.size(), this->sequence_.data());
+    return std::move(*this);
+  }
+
   /**
    * Unary minus operator: Returns this sequence in reverse.
    */
-  Polynucleotide operator-() const {
+  Polynucleotide operator-() const & {
     cs19::Polynucleotide reverse_sequence(this->complements_);
-    for (auto pos = this->sequence_.crbegin(); pos != this->sequence_.crend(); ++pos) {
-      reverse_sequence += *pos;
-    }
+    char *out = reverse_sequence.resize_for_overwrite(this->sequence_.size());
+    std::reverse_copy(this->sequence_.cbegin(), this->sequence_.cend(), out);
     return reverse_sequence;
   }
 
+  /**
+   * Unary minus operator: Reverses an expiring sequence in place, reusing its storage.
+   */
+  Polynucleotide operator-() && {
+    std::reverse(this->sequence_.begin(), this->sequence_.end());
+    return std::move(*this);
+  }
+
+  /**
+   * Returns this sequence's reverse complement (equivalent to -~sequence) in a single pass.
+   */
+  Polynucleotide reverse_complement() const & {
+    cs19::Polynucleotide reverse_complement_sequence(this->complements_);
+    std::size_t len = this->sequence_.size();
+    char *out = reverse_complement_sequence.resize_for_overwrite(len);
+    bool valid = true;  // whether every complement is itself in the mapping
+    for (std::size_t i = 0; i < len; ++i) {
+      char complement = this->complements_[this->sequence_[len - 1 - i]];
+      valid &= this->complements_.is_valid(complement);
+      out[i] = complement;
+    }
+    if (!valid)
+      throw std::domain_error("Invalid Character");
+    return reverse_complement_sequence;
+  }
+
+  /**
+   * Reverse-complements an expiring sequence in place, reusing its storage.
+   */
+  Polynucleotide reverse_complement() && {
+    std::reverse(this->sequence_.begin(), this->sequence_.end());
+    this->complement_into(this->sequence_.data(), this->sequence_.size(), this->sequence_.data());
+    return std::move(*this);
+  }
+
   /**
    * Addition operator: Returns this sequence concatenated with another.
+   * @throws std::domain_error if that sequence contains nucleotides invalid for this sequence
    */
   Polynucleotide operator+(const Polynucleotide &that) const {
+    if (that.complements_ != this->complements_ &&
+        this->complements_.find_invalid(that.sequence_.data(), that.size()) != that.size())
+      throw std::domain_error("Invalid Character");
     cs19::Polynucleotide concatenated(this->complements_);
-    concatenated.operator+=(this->sequence_ + that.sequence_);
+    concatenated.sequence_.reserve(this->size() + that.size());
+    concatenated.sequence_.append(this->sequence_).append(that.sequence_);
     return concatenated;
   }
 
@@ -240,9 +575,9 @@ class Polynucleotide {
       throw std::domain_error("Repeat count is negative");
     } else {
       cs19::Polynucleotide repeated(this->complements_);
-      for (int i = 0; i < repeat_count; ++i) {
-        repeated += this->sequence_;
-      }
+      repeated.sequence_.reserve(repeated_size(this->sequence_.size(), repeat_count));
+      repeated.sequence_ = this->sequence_;  // fits in the reserved capacity
+      repeat(repeated.sequence_, repeat_count);
       return repeated;
     }
   }
@@ -251,11 +586,16 @@ class Polynucleotide {
    * Assignment operator: Copies another polynucleotide's attributes to this object.
    */
   Polynucleotide &operator=(const Polynucleotide &that) {
-    this->sequence_ = that.to_string();
+    this->sequence_ = that.sequence_;
     this->complements_ = that.complements_;
     return *this;
   }
 
+  /**
+   * Move assignment operator: Takes over another polynucleotide's attributes without copying.
+   */
+  Polynucleotide &operator=(Polynucleotide &&that) noexcept = default;
+
   /**
    * Logical equality:
    * Two Polynucleotide objects compare equal if they contain the same sequence of nucleotides.
@@ -268,12 +608,7 @@ class Polynucleotide {
    * Stream insertion operator: object will appear as a plain string sequence, e.g. "GATTACA".
    */
   friend std::ostream &operator<<(std::ostream &out, const Polynucleotide &polynucleotide) {
-    std::string seq = polynucleotide.to_string();
-    std::size_t len = seq.size();
-    for (int i = 0; i < len; ++i) {
-      out << seq[i];
-    }
-    return out;
+    return out.write(polynucleotide.sequence_.data(), polynucleotide.sequence_.size());
   }
 
   /**
@@ -290,6 +625,27 @@ class Polynucleotide {
     return this->sequence_;  // Will return a *copy* of our private, encapsulated string object
   }
 
+  /**
+   * Returns a non-owning view of this sequence's nucleotides, valid until this object is modified.
+   */
+  std::string_view view() const {
+    return this->sequence_;
+  }
+
+  /**
+   * Returns lazy, non-owning views of this sequence in reverse, complemented, or
+   * reverse-complemented order, valid until this object is modified.
+   */
+  NucleotideView reverse_view() const {
+    return NucleotideView(this->sequence_, this->complements_, true, false);
+  }
+  NucleotideView complement_view() const {
+    return NucleotideView(this->sequence_, this->complements_, false, true);
+  }
+  NucleotideView reverse_complement_view() const {
+    return NucleotideView(this->sequence_, this->complements_, true, true);
+  }
+
   /**
    * Returns the length of this sequence.
    */
@@ -297,6 +653,13 @@ class Polynucleotide {
     return this->sequence_.size();
   }
 
+  /**
+   * Preallocates storage for at least the given number of nucleotides, e.g. before many appends.
+   */
+  void reserve(std::size_t capacity) {
+    this->sequence_.reserve(capacity);
+  }
+
   /**
    * Sets the value of the nucleotide at the given position to the given value.
    * @param pos the position/index to set
@@ -304,7 +667,7 @@ class Polynucleotide {
    * @throws std::domain_error if nucleotide is an invalid character
    */
   void set(std::size_t pos, char nucleotide) {
-    if (this->complements_[nucleotide]) {
+    if (this->complements_.is_valid(nucleotide)) {
       this->sequence_[pos] = nucleotide;
     } else {
       throw std::domain_error("Invalid Character");
@@ -322,9 +685,8 @@ class Polynucleotide {
    * many nucleotides as possible are used).
    */
   Polynucleotide subsequence(std::size_t pos, std::size_t count) const {
-    std::string sub_sequence = this->sequence_.substr(pos, count);
     cs19::Polynucleotide sub_seq(this->complements_);
-    sub_seq += sub_sequence;
+    sub_seq.sequence_ = this->sequence_.substr(pos, count);  // a slice of valid nucleotides
     return sub_seq;
   }
 
@@ -334,31 +696,95 @@ class Polynucleotide {
    * @return the Hamming distance
    * @throws std::domain_error if the two sequences are of unequal length
    */
-  int hamming_distance(const Polynucleotide &that) {
-    std::string that_sequence = that.to_string();
-    std::size_t len = that_sequence.size();
+  int hamming_distance(const Polynucleotide &that) const {
+    std::size_t len = that.sequence_.size();
     if (len != this->sequence_.size()) {
       throw std::domain_error("String sizes not equal");
     } else {
-      int hamming_distance = 0;
-      for (int i = 0; i < len; ++i) {
-        if (that_sequence[i] != this->sequence_[i]) {
-          ++hamming_distance;
-        }
-      }
-      return hamming_distance;
+      return static_cast<int>(
+          kernels::active().count_mismatches(this->sequence_.data(), that.sequence_.data(), len));
     }
   }
 
+  /**
+   * Computes the Hamming distance between this sequence and another, splitting the work across
+   * threads. Returned as std::size_t, since genome-scale distances can exceed the range of int.
+   * @param that the other sequence
+   * @param policy how to split the work, e.g. cs19::par
+   * @throws std::domain_error if the two sequences are of unequal length
+   */
+  std::size_t hamming_distance(const Polynucleotide &that, const ParallelPolicy &policy) const {
+    std::size_t len = that.sequence_.size();
+    if (len != this->sequence_.size())
+      throw std::domain_error("String sizes not equal");
+    std::size_t distance = 0;
+    for (std::size_t partial : parallel::map_chunks<std::size_t>(
+             len, policy, [this, &that](std::size_t begin, std::size_t end) {
+               return kernels::active().count_mismatches(this->sequence_.data() + begin,
+                                                         that.sequence_.data() + begin,
+                                                         end - begin);
+             }))
+      distance += partial;
+    return distance;
+  }
+
   /**
    * Returns a mapping of each unique nucleotide in the sequence to its frequency in the sequence.
    */
   std::map<char, int> nucleotide_counts() const {
-    std::map<char, int> nuc_counts;
-    for (const char& c : this->sequence_) {
-      ++nuc_counts[c];
+    std::string alphabet = this->complements_.nucleotides();
+    return to_count_map<int>(alphabet, this->count_alphabet(alphabet, 0, this->sequence_.size()));
+  }
+
+  /**
+   * Returns a mapping of each unique nucleotide in the sequence to its frequency in the sequence,
+   * splitting the work across threads. Frequencies are std::size_t, since genome-scale counts can
+   * exceed the range of int.
+   * @param policy how to split the work, e.g. cs19::par
+   */
+  std::map<char, std::size_t> nucleotide_counts(const ParallelPolicy &policy) const {
+    std::string alphabet = this->complements_.nucleotides();
+    std::vector<std::size_t> totals(alphabet.size());
+    for (const auto &partial : parallel::map_chunks<std::vector<std::size_t>>(
+             this->sequence_.size(), policy, [this, &alphabet](std::size_t begin, std::size_t end) {
+               return this->count_alphabet(alphabet, begin, end);
+             })) {
+      for (std::size_t i = 0; i < totals.size(); ++i)
+        totals[i] += partial[i];
     }
-    return nuc_counts;
+    return to_count_map<std::size_t>(alphabet, totals);
+  }
+
+  /**
+   * Returns this sequence's complementary sequence (like operator~), splitting the work across
+   * threads.
+   * @param policy how to split the work, e.g. cs19::par
+   */
+  Polynucleotide complement(const ParallelPolicy &policy) const {
+    cs19::Polynucleotide complement_sequence(this->complements_);
+    char *out = complement_sequence.resize_for_overwrite(this->sequence_.size());
+    parallel::for_each_chunk(this->sequence_.size(), policy,
+                             [this, out](std::size_t, std::size_t begin, std::size_t end) {
+                               this->complement_into(this->sequence_.data() + begin, end - begin,
+                                                     out + begin);
+                             });
+    return complement_sequence;
+  }
+
+  /**
+   * Returns this sequence in reverse (like unary operator-), splitting the work across threads.
+   * @param policy how to split the work, e.g. cs19::par
+   */
+  Polynucleotide reverse(const ParallelPolicy &policy) const {
+    cs19::Polynucleotide reverse_sequence(this->complements_);
+    std::size_t len = this->sequence_.size();
+    char *out = reverse_sequence.resize_for_overwrite(len);
+    parallel::for_each_chunk(len, policy,
+                             [this, out, len](std::size_t, std::size_t begin, std::size_t end) {
+                               std::reverse_copy(this->sequence_.data() + begin,
+                                                 this->sequence_.data() + end, out + len - end);
+                             });
+    return reverse_sequence;
   }
 
   // Convenience functions to make a Polynucleotide const-iterable
@@ -376,8 +802,101 @@ class Polynucleotide {
   }
 
  protected:
-  std::map<char, char> complements_;  // use this for determining valid nucleotides and complements
-  std::string sequence_;              // we'll store the actual nucleotide sequence here
+  /**
+   * Conversion constructor for derived classes: Takes over the nucleotides of an expiring
+   * Polynucleotide, validating them only if its mapping differs from the given one.
+   *
+   * @throws std::domain_error if the expiring sequence contains invalid nucleotide characters
+   */
+  Polynucleotide(Polynucleotide &&expiring, const ComplementTable &complements)
+      : complements_(complements) {
+    if (expiring.complements_ != complements &&
+        complements.find_invalid(expiring.sequence_.data(), expiring.size()) != expiring.size())
+      throw std::domain_error("Invalid Character");
+    this->sequence_ = std::move(expiring.sequence_);
+  }
+
+  /**
+   * Resizes this sequence for its contents to be overwritten in place; returns its storage.
+   */
+  char *resize_for_overwrite(std::size_t size) {
+    this->sequence_.resize(size);
+    return this->sequence_.data();
+  }
+
+  /**
+   * Counts the occurrences of each nucleotide of alphabet in sequence_[begin, end), 4 per pass.
+   */
+  std::vector<std::size_t> count_alphabet(const std::string &alphabet, std::size_t begin,
+                                          std::size_t end) const {
+    std::vector<std::size_t> counts(alphabet.size());
+    for (std::size_t first = 0; first < alphabet.size(); first += 4) {
+      char targets[4];
+      std::size_t totals[4];
+      for (std::size_t t = 0; t < 4; ++t)
+        targets[t] = alphabet[first + t < alphabet.size() ? first + t : first];
+      kernels::active().count_each4(this->sequence_.data() + begin, end - begin, targets, totals);
+      for (std::size_t t = 0; t < 4 && first + t < alphabet.size(); ++t)
+        counts[first + t] = totals[t];
+    }
+    return counts;
+  }
+
+  /**
+   * Builds a nucleotide count map from per-nucleotide counts, omitting nucleotides never seen.
+   * Every stored nucleotide is valid, so counting the whole alphabet accounts for all of them.
+   */
+  template <typename Count>
+  static std::map<char, Count> to_count_map(const std::string &alphabet,
+                                            const std::vector<std::size_t> &counts) {
+    std::map<char, Count> nuc_counts;
+    for (std::size_t i = 0; i < alphabet.size(); ++i) {
+      if (counts[i])
+        nuc_counts[alphabet[i]] = static_cast<Count>(counts[i]);
+    }
+    return nuc_counts;
+  }
+
+  /**
+   * Returns the length of a sequence of the given length repeated repeat_count times.
+   * @throws std::length_error if the result would exceed the maximum possible sequence size
+   */
+  std::size_t repeated_size(std::size_t size, int repeat_count) const {
+    if (size && static_cast<std::size_t>(repeat_count) > this->sequence_.max_size() / size)
+      throw std::length_error("Repeated sequence too long");
+    return size * repeat_count;
+  }
+
+  /**
+   * Replaces sequence with repeat_count copies of itself, using O(log repeat_count) memcpy calls
+   * that each double the filled prefix. The copies are not revalidated. Callers should reserve the
+   * final size first, so that the resize below does not reallocate.
+   */
+  static void repeat(std::string &sequence, int repeat_count) {
+    std::size_t unit = sequence.size(), total = unit * repeat_count;
+    sequence.resize(total);
+    char *data = sequence.data();
+    for (std::size_t filled = unit; filled && filled < total; filled *= 2)
+      std::memcpy(data + filled, data, std::min(filled, total - filled));
+  }
+
+  /**
+   * Writes the complements of count nucleotides to out, which may alias the input.
+   * @throws std::domain_error if the mapping is missing any of the complements produced
+   */
+  void complement_into(const char *nucleotides, std::size_t count, char *out) const {
+    bool valid = true;
+    for (std::size_t i = 0; i < count; ++i) {
+      char complement = this->complements_[nucleotides[i]];
+      valid &= this->complements_.is_valid(complement);
+      out[i] = complement;
+    }
+    if (!valid)
+      throw std::domain_error("Invalid Character");
+  }
+
+  ComplementTable complements_;  // use this for determining valid nucleotides and complements
+  std::string sequence_;         // we'll store the actual nucleotide sequence here
 };
 
 }  // namespace cs19
@@ -0,0 +1,246 @@
+/**
+ * @file cs19_sequence_file.h
+ *
+ * A memory-mapped reader for FASTA and FASTQ files, producing cs19::Dna objects or zero-copy views
+ * of each record without reading the file through iostreams. POSIX only.
+ */
+#ifndef _CS19_SEQUENCE_FILE_H
+#define _CS19_SEQUENCE_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "cs19_dna.h"
+
+namespace cs19 {
+
+/**
+ * Class MappedFile maps an entire file read-only into memory for as long as the object lives.
+ */
+class MappedFile {
+ public:
+  /**
+   * Maps the file at the given path.
+   * @throws std::system_error if the file cannot be opened or mapped
+   */
+  explicit MappedFile(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::system_error(errno, std::generic_category(), "open " + path);
+    struct stat info;
+    if (::fstat(fd, &info) < 0) {
+      int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), "fstat " + path);
+    }
+    this->size_ = static_cast<std::size_t>(info.st_size);
+    if (this->size_) {  // mapping zero bytes is an error, but an empty file is not
+      void *data = ::mmap(nullptr, this->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "mmap " + path);
+      }
+      ::madvise(data, this->size_, MADV_SEQUENTIAL);
+      this->data_ = static_cast<const char *>(data);
+    }
+    ::close(fd);  // the mapping remains valid after the descriptor is closed
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() {
+    if (this->data_)
+      ::munmap(const_cast<char *>(this->data_), this->size_);
+  }
+
+  /**
+   * Returns the contents of the file.
+   */
+  std::string_view contents() const {
+    return {this->data_, this->size_};
+  }
+
+ private:
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+/**
+ * Class SequenceFile iterates over the records of a memory-mapped FASTA or FASTQ file. The format
+ * is detected from the first character of the file ('>' for FASTA, '@' for FASTQ). FASTA sequences
+ * may span any number of lines; FASTQ records must use the common four-line layout. Both LF and
+ * CRLF line endings are accepted, as are blank lines before and between records.
+ */
+class SequenceFile {
+ public:
+  enum class Format { FASTA, FASTQ };
+
+  /**
+   * A zero-copy view of one record, valid for the lifetime of the SequenceFile that produced it.
+   */
+  class Record {
+   public:
+    /**
+     * Returns the record's header line, without the leading '>' or '@'.
+     */
+    std::string_view name() const {
+      return this->name_;
+    }
+
+    /**
+     * Calls fn(std::string_view) for each line of the record's sequence, in order, with line
+     * breaks removed. Lines are views directly into the mapped file.
+     */
+    template <typename Function>
+    void for_each_line(Function fn) const {
+      std::string_view block = this->block_;
+      while (!block.empty()) {
+        std::size_t end = block.find('\n');
+        std::string_view line = block.substr(0, end);
+        if (!line.empty() && line.back() == '\r')
+          line.remove_suffix(1);
+        if (!line.empty())
+          fn(line);
+        if (end == std::string_view::npos)
+          break;
+        block.remove_prefix(end + 1);
+      }
+    }
+
+    /**
+     * Returns the number of nucleotides in the record.
+     */
+    std::size_t size() const {
+      std::size_t total = 0;
+      this->for_each_line([&total](std::string_view line) { total += line.size(); });
+      return total;
+    }
+
+    /**
+     * Builds a cs19::Dna containing the record's sequence, validating each line in bulk.
+     * @throws std::domain_error if the sequence contains invalid DNA characters
+     */
+    Dna to_dna() const {
+      Dna dna;
+      dna.reserve(this->size());
+      this->for_each_line([&dna](std::string_view line) { dna += line; });
+      return dna;
+    }
+
+   private:
+    friend class SequenceFile;
+    std::string_view name_;
+    std::string_view block_;  // the sequence line(s), including line breaks
+  };
+
+  /**
+   * Maps the file at the given path.
+   * @throws std::system_error if the file cannot be opened or mapped
+   * @throws std::domain_error if the file is neither FASTA nor FASTQ
+   */
+  explicit SequenceFile(const std::string &path) : file_(path), remaining_(file_.contents()) {
+    this->skip_blank_lines();
+    if (!this->remaining_.empty() && this->remaining_[0] == '@')
+      this->format_ = Format::FASTQ;
+    else if (!this->remaining_.empty() && this->remaining_[0] != '>')
+      throw std::domain_error("Not a FASTA or FASTQ file");
+  }
+
+  Format format() const {
+    return this->format_;
+  }
+
+  /**
+   * Advances to the next record.
+   * @param[out] record set to a view of the next record
+   * @return false if there are no more records
+   * @throws std::domain_error for a truncated or malformed record, including one that does not
+   *     begin with the '>' or '@' of the file's format
+   */
+  bool next(Record &record) {
+    this->skip_blank_lines();
+    if (this->remaining_.empty())
+      return false;
+    if (this->format_ == Format::FASTQ && this->remaining_[0] != '@')
+      throw std::domain_error("Malformed FASTQ record");
+    if (this->format_ == Format::FASTA && this->remaining_[0] != '>')
+      throw std::domain_error("Malformed FASTA record");
+    this->remaining_.remove_prefix(1);
+    record.name_ = trim_line_end(this->take_line());
+    if (this->format_ == Format::FASTA) {
+      std::size_t end = 0;  // the sequence runs until the next line starting with '>'
+      while (end < this->remaining_.size() && this->remaining_[end] != '>') {
+        std::size_t line_end = this->remaining_.find('\n', end);
+        end = line_end == std::string_view::npos ? this->remaining_.size() : line_end + 1;
+      }
+      record.block_ = this->remaining_.substr(0, end);
+      this->remaining_.remove_prefix(end);
+    } else {
+      record.block_ = this->take_line();
+      std::string_view separator = this->take_line();
+      std::string_view quality = trim_line_end(this->take_line());
+      if (separator.empty() || separator[0] != '+' || quality.size() != record.size())
+        throw std::domain_error("Malformed FASTQ record");
+    }
+    return true;
+  }
+
+  /**
+   * Reads every remaining record into its own cs19::Dna object.
+   * @throws std::domain_error if any sequence contains invalid DNA characters
+   */
+  std::vector<Dna> load_dna() {
+    std::vector<Dna> sequences;
+    Record record;
+    while (this->next(record))
+      sequences.push_back(record.to_dna());
+    return sequences;
+  }
+
+ private:
+  static std::string_view trim_line_end(std::string_view line) {
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+      line.remove_suffix(1);
+    return line;
+  }
+
+  // Removes any lines holding nothing but whitespace
+  void skip_blank_lines() {
+    std::size_t text = this->remaining_.find_first_not_of(" \t\r\n");
+    if (text == std::string_view::npos) {
+      this->remaining_ = {};
+    } else {
+      std::size_t line_break = this->remaining_.rfind('\n', text);
+      if (line_break != std::string_view::npos)
+        this->remaining_.remove_prefix(line_break + 1);
+    }
+  }
+
+  // Removes and returns the next line, including its line break
+  std::string_view take_line() {
+    std::size_t end = this->remaining_.find('\n');
+    end = end == std::string_view::npos ? this->remaining_.size() : end + 1;
+    std::string_view line = this->remaining_.substr(0, end);
+    this->remaining_.remove_prefix(end);
+    return line;
+  }
+
+  MappedFile file_;
+  std::string_view remaining_;  // the unread portion of the file
+  Format format_ = Format::FASTA;
+};
+
+}  // namespace cs19
+
+#endif  // _CS19_SEQUENCE_FILE_H
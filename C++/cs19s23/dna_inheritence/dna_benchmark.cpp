@@ -0,0 +1,212 @@
+/**
+ * @file dna_benchmark.cpp
+ *
+ * Benchmarks for the dna_inheritence module, meant to catch performance regressions in
+ * cs19_polynucleotide.h and cs19_dna.h.
+ *
+ * The first table times cs19::Polynucleotide/cs19::Dna operations on several kinds of input
+ * (uniformly random bases, a tandem repeat, and a genome-like composition with ~41% GC content and
+ * homopolymer runs) at sizes from 10 bases up to max_bases, reporting ns per base and the bytes
+ * heap-allocated by a single call.
+ *
+ * The second table compares the scalar and vectorized kernels behind gc_content(),
+ * nucleotide_counts() and hamming_distance() at 1 KiB, 1 MiB and 1 GiB (or up to max_bytes),
+ * verifying that every instruction set produces results identical to the scalar kernels.
+ *
+ * Usage: dna_benchmark [max_bases [max_bytes]]  (defaults 1000000000 and 1 GiB)
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cs19_dna.h"
+#include "cs19_nucleotide_kernels.h"
+
+// Count every byte requested from the global heap, so operations can report their allocations.
+static std::atomic<std::size_t> bytes_allocated{0};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"  // new and delete below both use malloc
+#endif
+
+void *operator new(std::size_t size) {
+  bytes_allocated += size;
+  if (void *memory = std::malloc(size ? size : 1))
+    return memory;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+volatile std::size_t sink = 0;  // keeps the optimizer from discarding results
+
+// Runs fn repeatedly until at least ~0.2 s have elapsed; returns mean seconds per call.
+template <typename Function>
+double time_per_call(Function fn) {
+  using clock = std::chrono::steady_clock;
+  std::size_t calls = 0;
+  auto start = clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+    fn();
+    ++calls;
+    elapsed = clock::now() - start;
+  } while (elapsed.count() < 0.2);
+  return elapsed.count() / calls;
+}
+
+// Returns the bytes heap-allocated by a single call of fn.
+template <typename Function>
+std::size_t bytes_per_call(Function fn) {
+  std::size_t before = bytes_allocated;
+  fn();
+  return bytes_allocated - before;
+}
+
+std::string random_bases(std::size_t count, unsigned seed) {
+  std::mt19937 engine(seed);
+  std::string bases(count, 'A');
+  for (auto &base : bases)
+    base = "ACGT"[engine() & 3];
+  return bases;
+}
+
+std::string tandem_repeat(std::size_t count) {
+  const std::string unit = "GATTACAGGCATTAGC";
+  std::string bases(count, 'A');
+  for (std::size_t i = 0; i < count; ++i)
+    bases[i] = unit[i % unit.size()];
+  return bases;
+}
+
+// Roughly human-like: 29.5% each A/T, 20.5% each C/G, with runs (homopolymers) of 1-8 bases
+std::string genome_like(std::size_t count, unsigned seed) {
+  std::mt19937 engine(seed);
+  std::discrete_distribution<int> base({29.5, 20.5, 20.5, 29.5});
+  std::geometric_distribution<int> run(0.6);
+  std::string bases;
+  bases.reserve(count);
+  while (bases.size() < count) {
+    std::size_t length = std::min<std::size_t>(1 + std::min(run(engine), 7), count - bases.size());
+    bases.append(length, "ACGT"[base(engine)]);
+  }
+  return bases;
+}
+
+void report(const char *input, std::size_t size, const char *operation, double seconds,
+            std::size_t bytes) {
+  std::printf("%-12s %12zu  %-20s %10.3f %14zu\n", input, size, operation, seconds * 1e9 / size,
+              bytes);
+}
+
+template <typename Function>
+void measure(const char *input, std::size_t size, const char *operation, Function fn) {
+  std::size_t bytes = bytes_per_call(fn);
+  report(input, size, operation, time_per_call(fn), bytes);
+}
+
+void benchmark_operations(std::size_t max_bases) {
+  std::printf("%-12s %12s  %-20s %10s %14s\n", "input", "bases", "operation", "ns/base",
+              "bytes alloc'd");
+  for (std::size_t size = 10; size <= max_bases; size *= 100) {
+    struct Input {
+      const char *name;
+      std::string bases;
+    } inputs[] = {{"random", random_bases(size, 1)},
+                  {"repeat", tandem_repeat(size)},
+                  {"genome-like", genome_like(size, 2)}};
+    for (const Input &input : inputs) {
+      const std::string &bases = input.bases;
+      cs19::Dna dna(bases);
+      cs19::Dna other(random_bases(size, 3));
+      measure(input.name, size, "construct", [&] { sink = sink + cs19::Dna(bases).size(); });
+      measure(input.name, size, "operator+=", [&] {
+        cs19::Dna appended;
+        appended += bases;
+        sink = sink + appended.size();
+      });
+      measure(input.name, size, "operator~", [&] { sink = sink + (~dna).size(); });
+      measure(input.name, size, "operator-", [&] { sink = sink + (-dna).size(); });
+      measure(input.name, size, "reverse_complement",
+              [&] { sink = sink + dna.reverse_complement().size(); });
+      measure(input.name, size, "hamming_distance",
+              [&] { sink = sink + dna.hamming_distance(other); });
+      measure(input.name, size, "nucleotide_counts",
+              [&] { sink = sink + dna.nucleotide_counts().size(); });
+      measure(input.name, size, "gc_content",
+              [&] { sink = sink + static_cast<std::size_t>(dna.gc_content() * 100); });
+    }
+  }
+}
+
+void benchmark_kernels(std::size_t max_bytes) {
+  const cs19::kernels::Isa isas[] = {cs19::kernels::Isa::SCALAR, cs19::kernels::Isa::SSE2,
+                                     cs19::kernels::Isa::AVX2};
+  const char *isa_names[] = {"scalar", "sse2", "avx2"};
+  const char targets[4] = {'A', 'C', 'G', 'T'};
+
+  std::printf("\n%-12s %-18s %-7s %12s %10s\n", "bytes", "kernel", "isa", "GB/s", "speedup");
+  for (std::size_t size = 1 << 10; size <= max_bytes; size <<= 10) {
+    std::string a = random_bases(size, 1), b = random_bases(size, 2);
+    const auto reference = cs19::kernels::kernels_for(cs19::kernels::Isa::SCALAR);
+    std::size_t expected_gc = reference.count_either(a.data(), size, 'G', 'C');
+    std::size_t expected_mismatches = reference.count_mismatches(a.data(), b.data(), size);
+    std::size_t expected_counts[4];
+    reference.count_each4(a.data(), size, targets, expected_counts);
+
+    double scalar_seconds[3] = {};
+    for (std::size_t i = 0; i < 3; ++i) {
+      const auto kernels = cs19::kernels::kernels_for(isas[i]);
+      if (kernels.isa != isas[i])
+        continue;  // not supported by this CPU
+      std::size_t counts[4];
+      kernels.count_each4(a.data(), size, targets, counts);
+      for (int t = 0; t < 4; ++t)
+        assert(counts[t] == expected_counts[t]);
+      assert(kernels.count_either(a.data(), size, 'G', 'C') == expected_gc);
+      assert(kernels.count_mismatches(a.data(), b.data(), size) == expected_mismatches);
+
+      double seconds[3] = {
+          time_per_call([&] { sink = sink + kernels.count_either(a.data(), size, 'G', 'C'); }),
+          time_per_call([&] {
+            kernels.count_each4(a.data(), size, targets, counts);
+            sink = sink + counts[0];
+          }),
+          time_per_call([&] { sink = sink + kernels.count_mismatches(a.data(), b.data(), size); }),
+      };
+      const char *kernel_names[] = {"gc_content", "nucleotide_counts", "hamming_distance"};
+      for (int k = 0; k < 3; ++k) {
+        if (i == 0)
+          scalar_seconds[k] = seconds[k];
+        std::printf("%-12zu %-18s %-7s %12.2f %9.1fx\n", size, kernel_names[k], isa_names[i],
+                    size / seconds[k] / 1e9, scalar_seconds[k] / seconds[k]);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::size_t max_bases = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000000;
+  std::size_t max_bytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::size_t{1} << 30;
+  benchmark_operations(max_bases);
+  benchmark_kernels(max_bytes);
+  return static_cast<int>(sink & 0);
+}
@@ -7,7 +7,11 @@
  * @author A Cabrillo student for CS 19, someone@jeff.cis.cabrillo.edu
  */
  
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <set>
@@ -17,6 +21,11 @@
 #include <vector>
  
 #include "cs19_dna.h"
+#include "cs19_dna_distance.h"
+#include "cs19_dna_rope.h"
+#include "cs19_fm_index.h"
+#include "cs19_packed_dna.h"
+#include "cs19_sequence_file.h"
  
 // A bunch of tests with GATTACA. Can't get enough GATTACA! 😉
 int main() {
@@ -33,6 +42,13 @@ int main() {
     assert(~test == cs19::Dna("CTAATGT"));
     assert(-test == cs19::Dna("ACATTAG"));
     assert(test.hamming_distance(-~test) == 5);
+    assert(test.reverse_complement() == -~test);
+    assert(test.reverse_complement_view().to_string() == "TGTAATC");
+    assert(test.reverse_view().to_string() == "ACATTAG");
+    auto it = test.reverse_complement_view().begin();  // outlives its temporary view
+    assert(it[0] == 'T' && *(2 + it) == 'T' && it + 7 > it && it <= it && it + 1 >= it);
+    assert(test.complement_view().reversed().to_string() == "TGTAATC");
+    assert(*test.complement_view().begin() == 'C');
     std::stringstream stream;
     stream << test;
     assert(stream.str() == "GATTACA");
@@ -60,6 +76,8 @@ int main() {
     }
     test *= 2;
     assert(test.to_string() == "GATTACATGATTACATGATTACATGATTACAT");
+    assert((test * 0).size() == 0 && (test * 3).size() == 3 * test.size());
+    assert((test * 1000000).size() == 32000000 && (test * 1000000)[31999999] == 'T');
     assert(test.subsequence(5, 3) == cs19::Dna("CAT"));
     try {
       test.hamming_distance(cs19::Dna("GATTACA"));
@@ -74,4 +92,210 @@ int main() {
   } catch (std::domain_error &err) {
     assert(true);
   }
-}
\ No newline at end of file
+  // complement tables are usable at compile time, and map-based mappings still work at runtime
+  static_assert(cs19::Dna::COMPLEMENTS['G'] == 'C' && !cs19::Dna::COMPLEMENTS.is_valid('U'));
+  cs19::Polynucleotide rna(std::map<char, char>{{'A', 'U'}, {'U', 'A'}, {'C', 'G'}, {'G', 'C'}});
+  rna += "GAUUACA";
+  assert((~rna).to_string() == "CUAAUGU");
+  try {
+    rna += "GATTACA";
+    assert(false);
+  } catch (std::domain_error &err) {
+    assert(rna.to_string() == "GAUUACA");  // bulk appends are all-or-nothing
+  }
+  // moves transfer storage, views alias it, and expiring results convert back to Dna in place
+  cs19::Dna original(std::string(64, 'G') + "ATTACA");
+  const char *storage = original.view().data();
+  cs19::Dna moved(std::move(original));
+  assert(moved.view().data() == storage && moved.view().substr(63) == "GATTACA");
+  cs19::Dna reverse_complement = -~moved;
+  assert(reverse_complement.view().substr(0, 7) == "TGTAATC");
+  moved = std::move(reverse_complement);
+  assert(moved.size() == 70 && moved[69] == 'C');
+  try {
+    cs19::Dna(std::move(rna));
+    assert(false);
+  } catch (std::domain_error &err) {
+    assert(true);
+  }
+  // memory-mapped FASTA/FASTQ records, multi-line and CRLF included, as Dna objects and views
+  std::string fasta_path = (std::filesystem::temp_directory_path() / "cs19_dna_tests.fa").string();
+  std::ofstream(fasta_path) << "\r\n\n>one\nGATT\r\nACA\n>empty\n>two\nCAT";
+  cs19::SequenceFile fasta(fasta_path);
+  std::vector<cs19::Dna> records = fasta.load_dna();
+  assert(records.size() == 3 && records[0] == cs19::Dna("GATTACA") && records[1].size() == 0 &&
+         records[2] == cs19::Dna("CAT"));
+  std::ofstream(fasta_path) << "\n@read\nGATTACA\n+\nIIIIIII\n\n@more\nCAT\n+\nIII\n\r\n";
+  cs19::SequenceFile fastq(fasta_path);
+  cs19::SequenceFile::Record record;
+  assert(fastq.format() == cs19::SequenceFile::Format::FASTQ);
+  assert(fastq.next(record) && record.name() == "read" && record.to_dna() == cs19::Dna("GATTACA"));
+  assert(fastq.next(record) && record.name() == "more" && record.to_dna() == cs19::Dna("CAT"));
+  assert(!fastq.next(record));
+  // a record out of step, here one missing its '@', must not be read with a corrupted header
+  std::ofstream(fasta_path) << "@read\nGATTACA\n+\nIIIIIII\nmore\nCAT\n+\nIII\n";
+  cs19::SequenceFile misaligned(fasta_path);
+  assert(misaligned.next(record) && record.name() == "read");
+  try {
+    misaligned.next(record);
+    assert(false);
+  } catch (std::domain_error &err) {
+    assert(true);
+  }
+  std::remove(fasta_path.c_str());
+  // parallel analytics split into many small chunks must match the serial results exactly
+  cs19::Dna long_dna = cs19::Dna("GATTACAGGC") * 1001;
+  cs19::ParallelPolicy four_threads{4, 100};
+  assert(long_dna.gc_content(four_threads) == long_dna.gc_content());
+  std::map<char, std::size_t> parallel_counts = long_dna.nucleotide_counts(four_threads);
+  assert(parallel_counts.size() == 4);
+  for (const auto &[nucleotide, count] : long_dna.nucleotide_counts())
+    assert(parallel_counts[nucleotide] == static_cast<std::size_t>(count));
+  assert(long_dna.hamming_distance(-long_dna, four_threads) ==
+         static_cast<std::size_t>(long_dna.hamming_distance(-long_dna)));
+  assert(long_dna.complement(four_threads) == ~long_dna);
+  assert(long_dna.reverse(four_threads) == -long_dna);
+  assert(long_dna.reverse(cs19::par) == -long_dna);
+  // windowed GC content and k-mer counts
+  cs19::Dna windows("GGCCATATGC");
+  assert((windows.windowed_gc_content(4, 2) == std::vector<double>{1, 0.5, 0, 0.5}));
+  assert((windows.windowed_gc_content(3, 5) == std::vector<double>{1, 0}));
+  assert(windows.windowed_gc_content(11, 1).empty());
+  cs19::SlidingGcContent sliding(4);
+  for (char nucleotide : windows.view().substr(0, 6))
+    sliding.push(nucleotide);
+  assert(sliding.full() && sliding.value() == 0.5);
+  cs19::KmerCounter kmers = cs19::Dna(cs19::Dna("GATTACA") * 300).kmer_counts(3);
+  assert(kmers.count("ATT") == 300 && kmers.count("CAG") == 299 && kmers.count("GGG") == 0);
+  assert(kmers.distinct() == 7 && kmers.total() == 2098);
+  cs19::KmerCounter kmers31 = cs19::Dna(cs19::Dna("GATTACA") * 1000).kmer_counts(31);
+  assert(kmers31.distinct() == 7);
+  std::uint64_t total = 0;
+  kmers31.for_each([&](std::uint64_t key, std::uint64_t count) {
+    assert(kmers31.count(kmers31.decode(key)) == count);
+    total += count;
+  });
+  assert(total == kmers31.total());
+  // enough distinct k-mers to grow the table several times
+  std::string random_bases;
+  for (unsigned x = 7; random_bases.size() < 20000; x = x * 1103515245 + 12345)
+    random_bases += "ACGT"[(x >> 16) & 3];
+  cs19::KmerCounter kmers12(12);
+  kmers12.add(random_bases);
+  std::map<std::string, std::uint64_t> expected_kmers;
+  for (std::size_t pos = 0; pos + 12 <= random_bases.size(); ++pos)
+    ++expected_kmers[random_bases.substr(pos, 12)];
+  assert(kmers12.distinct() == expected_kmers.size());
+  for (const auto &[kmer, count] : expected_kmers)
+    assert(kmers12.count(kmer) == count);
+  for (unsigned k : {0u, 32u, 40u, 64u}) {
+    try {
+      cs19::KmerCounter invalid(k);
+      assert(false);
+    } catch (std::domain_error &err) {
+      assert(true);
+    }
+  }
+  // FM-index count/locate must agree with a naive search, before and after a save/load round trip
+  std::string genome;
+  for (unsigned x = 1; genome.size() < 5000; x = x * 1103515245 + 12345)
+    genome += "ACGT"[(x >> 16) & 3];
+  genome += "GATTACAGATTACA";
+  cs19::FmIndex built(cs19::Dna(genome), 7);
+  std::string index_path = (std::filesystem::temp_directory_path() / "cs19_dna_tests.fmi").string();
+  built.save(index_path);
+  cs19::FmIndex loaded = cs19::FmIndex::load(index_path);
+  cs19::FmIndex from_string(genome, 7);
+  for (const cs19::FmIndex *index : {&built, &loaded, &from_string}) {
+    assert(index->size() == genome.size());
+    for (std::string motif : {"GATTACA", "ACGT", "T", "CCCCCCCC", "TACAGATT", "GATTACAGATTACA"}) {
+      std::vector<std::size_t> expected;
+      for (auto pos = genome.find(motif); pos != std::string::npos;
+           pos = genome.find(motif, pos + 1))
+        expected.push_back(pos);
+      assert(index->count(motif) == expected.size());
+      assert(index->locate(motif) == expected);
+    }
+    assert(index->count("GAUUACA") == 0);
+  }
+  std::remove(index_path.c_str());
+  // ropes share chunks between copies, concatenations and slices; set() leaves copies untouched
+  cs19::DnaRope rope(cs19::Dna("GATTACA"));
+  cs19::DnaRope copy = rope;
+  for (int i = 0; i < 1000; ++i)
+    rope += copy;
+  assert(rope.size() == 7007 && rope.subsequence(7000, 100).to_string() == "GATTACA");
+  cs19::DnaRope prepended;
+  std::string expected_prepended;
+  for (int i = 0; i < 1000; ++i) {
+    prepended = (i % 2 ? copy : copy.subsequence(2, 3)) + prepended;
+    expected_prepended.insert(0, i % 2 ? "GATTACA" : "TTA");
+  }
+  assert(prepended.to_string() == expected_prepended && prepended[3502] == expected_prepended[3502]);
+  cs19::DnaRope slice = rope.subsequence(5, 5);
+  assert(slice.to_string() == "CAGAT" && slice == cs19::DnaRope("CAGAT"));
+  assert(slice == cs19::DnaRope(std::string("CAGAT")));
+  slice.set(0, 'T');
+  assert(slice.to_dna() == cs19::Dna("TAGAT") && rope[5] == 'C' && copy.to_string() == "GATTACA");
+  std::stringstream rope_stream;
+  rope_stream << rope.subsequence(3, 6);
+  assert(rope_stream.str() == "TACAGA");
+  try {
+    slice.set(1, 'U');
+    assert(false);
+  } catch (std::domain_error &err) {
+    assert(true);
+  }
+  try {
+    cs19::DnaRope()[0];
+    assert(false);
+  } catch (std::out_of_range &err) {
+    assert(true);
+  }
+  // batch Hamming distances across tile boundaries must match pairwise hamming_distance()
+  std::vector<cs19::Dna> barcodes;
+  for (unsigned x = 7; barcodes.size() < 150; x = x * 1103515245 + 12345)
+    barcodes.push_back(cs19::Dna(std::string(40, "ACGT"[(x >> 16) & 3]) + "GATTACA"));
+  for (std::size_t i = 0; i < barcodes.size(); i += 3)
+    barcodes[i].set(i % 47, barcodes[i][i % 47] == 'A' ? 'C' : 'A');
+  cs19::DistanceMatrix matrix = cs19::hamming_matrix(barcodes, cs19::ParallelPolicy{3});
+  auto nearest = cs19::nearest_neighbors(barcodes, 5, cs19::ParallelPolicy{3});
+  for (std::size_t i = 0; i < barcodes.size(); ++i) {
+    std::vector<cs19::Neighbor> expected;
+    for (std::size_t j = 0; j < barcodes.size(); ++j) {
+      assert(matrix(i, j) == static_cast<unsigned>(barcodes[i].hamming_distance(barcodes[j])));
+      if (j != i)
+        expected.push_back({j, matrix(i, j)});
+    }
+    std::stable_sort(expected.begin(), expected.end(), [](auto &a, auto &b) {
+      return a.distance < b.distance;
+    });
+    expected.resize(5);
+    assert(nearest[i] == expected);
+  }
+  // 2-bit packed storage must agree with cs19::Dna, including across word boundaries
+  for (std::string bases : {std::string("GATTACA"), std::string(33, 'G') + "ATTACA" + "TTGCA"}) {
+    cs19::Dna dna(bases);
+    cs19::PackedDna packed(dna);
+    assert(packed.size() == dna.size());
+    assert(packed.to_string() == bases);
+    assert(packed.to_dna() == dna);
+    assert(packed[bases.size() - 1] == dna[bases.size() - 1]);
+    assert((~packed).to_string() == (~dna).to_string());
+    assert((-packed).to_string() == (-dna).to_string());
+    assert(packed.hamming_distance(-~packed) == dna.hamming_distance(-~dna));
+    assert(packed.nucleotide_counts() == dna.nucleotide_counts());
+    assert(packed.gc_content() == dna.gc_content());
+    std::stringstream stream;
+    stream << packed;
+    assert(stream.str() == bases);
+    packed.set(0, 'T');
+    assert(packed[0] == 'T');
+  }
+  try {
+    cs19::PackedDna("GAUUACA");
+    assert(false);
+  } catch (std::domain_error &err) {
+    assert(true);
+  }
+}
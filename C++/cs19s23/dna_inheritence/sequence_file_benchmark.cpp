@@ -0,0 +1,79 @@
+/**
+ * @file sequence_file_benchmark.cpp
+ *
+ * Measures the throughput of cs19::SequenceFile, both loading every record into a cs19::Dna and
+ * scanning records in zero-copy view mode (computing overall GC content).
+ *
+ * Usage: sequence_file_benchmark FILE
+ *        sequence_file_benchmark --generate FILE BYTES   (writes a random 60-column FASTA file)
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "cs19_sequence_file.h"
+
+namespace {
+
+void generate_fasta(const std::string &path, std::size_t bytes) {
+  std::ofstream out(path, std::ios::binary);
+  std::mt19937 engine(19);
+  std::string line(60, 'A');
+  for (std::size_t written = 0, record = 0; written < bytes; ++record) {
+    std::string header = ">record_" + std::to_string(record) + "\n";
+    out << header;
+    written += header.size();
+    for (int i = 0; i < 1000 && written < bytes; ++i, written += line.size() + 1) {
+      for (auto &base : line)
+        base = "ACGT"[engine() & 3];
+      out << line << '\n';
+    }
+  }
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc == 4 && std::string(argv[1]) == "--generate") {
+    generate_fasta(argv[2], std::strtoull(argv[3], nullptr, 10));
+    return 0;
+  }
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s FILE | --generate FILE BYTES\n", argv[0]);
+    return 1;
+  }
+  std::size_t file_size = cs19::MappedFile(argv[1]).contents().size();
+
+  auto start = std::chrono::steady_clock::now();
+  std::size_t gc = 0, bases = 0, records = 0;
+  {
+    cs19::SequenceFile file(argv[1]);
+    cs19::SequenceFile::Record record;
+    while (file.next(record)) {
+      ++records;
+      record.for_each_line([&](std::string_view line) {
+        gc += cs19::kernels::active().count_either(line.data(), line.size(), 'G', 'C');
+        bases += line.size();
+      });
+    }
+  }
+  double view_seconds = seconds_since(start);
+
+  start = std::chrono::steady_clock::now();
+  std::size_t loaded = cs19::SequenceFile(argv[1]).load_dna().size();
+  double load_seconds = seconds_since(start);
+
+  std::printf("%zu bytes, %zu records, %zu bases, GC content %.4f\n", file_size, records, bases,
+              bases ? static_cast<double>(gc) / bases : 0.0);
+  std::printf("view mode (gc scan): %.2f GB/s\n", file_size / view_seconds / 1e9);
+  std::printf("load_dna (%zu Dna):  %.2f GB/s\n", loaded, file_size / load_seconds / 1e9);
+}
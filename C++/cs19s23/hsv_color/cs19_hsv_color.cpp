@@ -1,8 +1,22 @@
 #include "cs19_hsv_color.h"
+#include <fcntl.h>
 #include <math.h>
-#include <iostream>
-#include <iomanip>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <cassert>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && \
+    !defined(CS19_HSV_COLOR_NO_SIMD)
+#define CS19_HSV_COLOR_X86 1
+#include <immintrin.h>
+#endif
 
 namespace cs19 {
     HsvColor::HsvColor(float hue, float saturation, float value) {
@@ -12,34 +26,6 @@ namespace cs19 {
         _hue = hue;
         _saturation = saturation;
         _value = value;
-        C = value * saturation;
-        X = C * (1 - fabs(fmod(hue / 60.0, 2) - 1));
-        m = value - C;
-        if (_hue >= 0 && _hue < 60) {
-            r = C;
-            g = X;
-            b = 0;
-        } else if (_hue >= 60 && _hue < 120) {
-            r = X;
-            g = C;
-            b = 0;
-        } else if (_hue >= 120 && _hue < 180) {
-            r = 0;
-            g = C;
-            b = X;
-        } else if (_hue >= 180 && _hue < 240) {
-            r = 0;
-            g = X;
-            b = C;
-        } else if (_hue >= 240 && _hue < 300) {
-            r = X;
-            g = 0;
-            b = C;
-        } else {
-            r = C;
-            g = 0;
-            b = X;
-        }
     }
 
     HsvColor HsvColor::operator~() const {
@@ -58,45 +44,86 @@ namespace cs19 {
         return HsvColor(_hue, 0, _value);
     }
 
+    namespace {
+        // The two lowercase hex digits and the decimal digits of every 8-bit component
+        struct Digits {
+            char hex[256][2] {};
+            char decimal[256][3] {};
+            std::uint8_t decimal_length[256] {};
+        };
+
+        constexpr Digits make_digits() {
+            Digits digits;
+            for (int byte = 0; byte < 256; ++byte) {
+                digits.hex[byte][0] = "0123456789abcdef"[byte >> 4];
+                digits.hex[byte][1] = "0123456789abcdef"[byte & 0xF];
+                int length = byte >= 100 ? 3 : byte >= 10 ? 2 : 1;
+                for (int place = length - 1, rest = byte; place >= 0; --place, rest /= 10) {
+                    digits.decimal[byte][place] = static_cast<char>('0' + rest % 10);
+                }
+                digits.decimal_length[byte] = static_cast<std::uint8_t>(length);
+            }
+            return digits;
+        }
+
+        constexpr Digits DIGITS = make_digits();
+
+        // Writes "#rrggbb", which takes HEX_STRING_LENGTH chars
+        char *write_hex(char *out, const std::uint8_t *rgb) {
+            *out++ = '#';
+            for (int channel = 0; channel < 3; ++channel, out += 2) {
+                std::memcpy(out, DIGITS.hex[rgb[channel]], 2);
+            }
+            return out;
+        }
+
+        std::size_t rgb_length(const std::uint8_t *rgb) {
+            return 7 + DIGITS.decimal_length[rgb[0]] + DIGITS.decimal_length[rgb[1]] +
+                   DIGITS.decimal_length[rgb[2]];
+        }
+
+        // Writes "rgb(r,g,b)", which takes rgb_length(rgb) chars
+        char *write_rgb(char *out, const std::uint8_t *rgb) {
+            std::memcpy(out, "rgb(", 4);
+            out += 4;
+            for (int channel = 0; channel < 3; ++channel) {
+                std::uint8_t length = DIGITS.decimal_length[rgb[channel]];
+                std::memcpy(out, DIGITS.decimal[rgb[channel]], length);
+                out += length;
+                *out++ = channel < 2 ? ',' : ')';
+            }
+            return out;
+        }
+    }
+
     std::string HsvColor::to_hex_string() const {
-        int red = this->red();
-        std::stringstream red_stream;
-        if (red >= 0 && red <= 15) {
-            red_stream << "0" << std::hex << red;
-        } else {
-            red_stream << std::hex << red;
-        }
-        std::string red_hex = red_stream.str();
-        int green = this->green();
-        std::stringstream green_stream;
-        if (green >= 0 && green <= 15) {
-            green_stream << "0" << std::hex << green;
-        } else {
-            green_stream << std::hex << green;
-        }
-        std::string green_hex = green_stream.str();
-        int blue = this->blue();
-        std::stringstream blue_stream;
-        if (blue >= 0 && blue <= 15) {
-            blue_stream << "0" << std::hex << blue;
-        } else {
-            blue_stream << std::hex << blue;
-        }
-        std::string blue_hex = blue_stream.str();
-        std::stringstream return_stream;
-        return_stream << "#" << red_hex << green_hex << blue_hex;
-        std::string return_string = return_stream.str();
-        return return_string;
+        char chars[HEX_STRING_LENGTH];
+        return std::string(chars, to_hex_chars(chars, chars + HEX_STRING_LENGTH).ptr);
     }
 
     std::string HsvColor::to_rgb_string() const {
-        std::string red = std::to_string(this->red());
-        std::string green = std::to_string(this->green());
-        std::string blue = std::to_string(this->blue());
-        std::stringstream return_stream;
-        return_stream << "rgb(" << red << "," << green << "," << blue << ")";
-        std::string return_string = return_stream.str();
-        return return_string;
+        char chars[MAX_RGB_STRING_LENGTH];
+        return std::string(chars, to_rgb_chars(chars, chars + MAX_RGB_STRING_LENGTH).ptr);
+    }
+
+    std::to_chars_result HsvColor::to_hex_chars(char *first, char *last) const {
+        if (last - first < static_cast<std::ptrdiff_t>(HEX_STRING_LENGTH)) {
+            return {last, std::errc::value_too_large};
+        }
+        const std::uint8_t rgb[3] = {static_cast<std::uint8_t>(red()),
+                                     static_cast<std::uint8_t>(green()),
+                                     static_cast<std::uint8_t>(blue())};
+        return {write_hex(first, rgb), std::errc()};
+    }
+
+    std::to_chars_result HsvColor::to_rgb_chars(char *first, char *last) const {
+        const std::uint8_t rgb[3] = {static_cast<std::uint8_t>(red()),
+                                     static_cast<std::uint8_t>(green()),
+                                     static_cast<std::uint8_t>(blue())};
+        if (static_cast<std::size_t>(last - first) < rgb_length(rgb)) {
+            return {last, std::errc::value_too_large};
+        }
+        return {write_rgb(first, rgb), std::errc()};
     }
 
     float HsvColor::hue() const {
@@ -112,14 +139,894 @@ namespace cs19 {
     }
 
     int HsvColor::red() const {
-        return floor((r + m) * 255 + 0.5);
+        return component(0);
     }
 
     int HsvColor::green() const {
-        return floor((g + m) * 255 + 0.5);
+        return component(1);
     }
 
     int HsvColor::blue() const {
-        return floor((b + m) * 255 + 0.5);
+        return component(2);
+    }
+
+    namespace {
+        enum Share { NONE, SECOND_LARGEST, CHROMA };
+
+        // Which share of the color each RGB component gets before m is added, for each 60° sector
+        // of hue
+        constexpr Share SECTOR_SHARES[6][3] = {
+            {CHROMA, SECOND_LARGEST, NONE}, {SECOND_LARGEST, CHROMA, NONE},
+            {NONE, CHROMA, SECOND_LARGEST}, {NONE, SECOND_LARGEST, CHROMA},
+            {SECOND_LARGEST, NONE, CHROMA}, {CHROMA, NONE, SECOND_LARGEST}};
+    }
+
+    // The chroma C, the second largest component X and the offset m are derived in the same
+    // precisions as when they were cached, so the results are unchanged; X is the only costly one,
+    // and is derived only for the component that needs it
+    int HsvColor::component(int index) const {
+        int sector = (_hue >= 60) + (_hue >= 120) + (_hue >= 180) + (_hue >= 240) + (_hue >= 300);
+        float C = _value * _saturation;
+        float m = _value - C;
+        float share = 0;
+        if (SECTOR_SHARES[sector][index] == CHROMA) {
+            share = C;
+        } else if (SECTOR_SHARES[sector][index] == SECOND_LARGEST) {
+            share = C * (1 - fabs(fmod(_hue / 60.0, 2) - 1));  // X
+        }
+        return floor((share + m) * 255 + 0.5);
+    }
+
+    namespace {
+        // The batch conversions read the components of each color from hues, saturations and
+        // values at multiples of stride: 1 for planes, or 3 for interleaved colors, which start at
+        // hues. The vector kernels load interleaved colors whole and deinterleave them. The vector
+        // kernels repeat the arithmetic of red(), green() and blue() step by step in the same
+        // precisions, so they round identically: X is computed in double as fmod() does, and
+        // floor(x + 0.5) as floor(x) plus whether the fraction is at least 0.5. Since a hue's
+        // sector is chosen by comparisons, each of r, g and b is a choice between C, X and 0 made
+        // by masks, without branches.
+        using Converter = void (*)(const float *hues, const float *saturations,
+                                   const float *values, std::size_t stride, std::size_t count,
+                                   std::uint8_t *rgb, RgbFormat format);
+
+        // Like the constructor's check, but also rejecting NaN, which has no RGB equivalent
+        bool in_range(float hue, float saturation, float value) {
+            return hue >= 0 && hue <= 360 && saturation >= 0 && saturation <= 1 && value >= 0 &&
+                   value <= 1;
+        }
+
+        void convert_scalar(const float *hues, const float *saturations, const float *values,
+                            std::size_t stride, std::size_t count, std::uint8_t *rgb,
+                            RgbFormat format) {
+            std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+            for (std::size_t i = 0; i < count * stride; i += stride, rgb += channels) {
+                if (!in_range(hues[i], saturations[i], values[i])) {
+                    throw std::domain_error("Parameter out of range");
+                }
+                HsvColor color(hues[i], saturations[i], values[i]);
+                rgb[0] = static_cast<std::uint8_t>(color.red());
+                rgb[1] = static_cast<std::uint8_t>(color.green());
+                rgb[2] = static_cast<std::uint8_t>(color.blue());
+                if (channels == 4) {
+                    rgb[3] = 255;
+                }
+            }
+        }
+
+#ifdef CS19_HSV_COLOR_X86
+        namespace sse2 {
+            // C * (1 - fabs(fmod(hue / 60.0, 2) - 1)) for two colors; the floor of the
+            // non-negative sixths / 2 is exact by truncation
+            __m128 x_of(__m128d hue, __m128d c) {
+                __m128d sixths = _mm_div_pd(hue, _mm_set1_pd(60.0));
+                __m128d twos = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_mul_pd(sixths,
+                                                                           _mm_set1_pd(0.5))));
+                __m128d remainder = _mm_sub_pd(sixths, _mm_add_pd(twos, twos));
+                __m128d distance = _mm_andnot_pd(_mm_set1_pd(-0.0),
+                                                 _mm_sub_pd(remainder, _mm_set1_pd(1.0)));
+                return _mm_cvtpd_ps(_mm_mul_pd(c, _mm_sub_pd(_mm_set1_pd(1.0), distance)));
+            }
+
+            // floor((component + m) * 255 + 0.5) as 32-bit ints
+            __m128i to_byte(__m128 component, __m128 m) {
+                __m128 scaled = _mm_mul_ps(_mm_add_ps(component, m), _mm_set1_ps(255));
+                __m128i whole = _mm_cvttps_epi32(scaled);
+                __m128 fraction = _mm_sub_ps(scaled, _mm_cvtepi32_ps(whole));
+                __m128 round_up = _mm_cmpge_ps(fraction, _mm_set1_ps(0.5f));
+                return _mm_sub_epi32(whole, _mm_castps_si128(round_up));
+            }
+
+            // Four colors, from planes or interleaved
+            void load(const float *hues, const float *saturations, const float *values,
+                      std::size_t stride, __m128 &hue, __m128 &saturation, __m128 &value) {
+                if (stride == 1) {
+                    hue = _mm_loadu_ps(hues);
+                    saturation = _mm_loadu_ps(saturations);
+                    value = _mm_loadu_ps(values);
+                    return;
+                }
+                __m128 a = _mm_loadu_ps(hues), b = _mm_loadu_ps(hues + 4);
+                __m128 c = _mm_loadu_ps(hues + 8);
+                hue = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)),
+                                     _MM_SHUFFLE(2, 0, 3, 0));
+                saturation = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                                            _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+                                            _MM_SHUFFLE(2, 0, 2, 0));
+                value = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                                       _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+                                       _MM_SHUFFLE(2, 0, 2, 0));
+            }
+
+            __m128 in_range(__m128 component, float high) {
+                return _mm_and_ps(_mm_cmpge_ps(component, _mm_setzero_ps()),
+                                  _mm_cmple_ps(component, _mm_set1_ps(high)));
+            }
+
+            void convert(const float *hues, const float *saturations, const float *values,
+                         std::size_t stride, std::size_t count, std::uint8_t *rgb,
+                         RgbFormat format) {
+                const std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+                const __m128i alpha = _mm_set1_epi32(channels == 4 ? 0xFF000000 : 0);
+                std::size_t i = 0;
+                for (; i + 4 <= count; i += 4, rgb += 4 * channels) {
+                    __m128 hue, saturation, value;
+                    load(hues + i * stride, saturations + i * stride, values + i * stride, stride,
+                         hue, saturation, value);
+                    __m128 valid = _mm_and_ps(in_range(hue, 360), _mm_and_ps(
+                        in_range(saturation, 1), in_range(value, 1)));
+                    if (_mm_movemask_ps(valid) != 0xF) {
+                        break;  // the scalar loop throws at the first color out of range
+                    }
+                    __m128 c = _mm_mul_ps(value, saturation);
+                    __m128 x = _mm_movelh_ps(
+                        x_of(_mm_cvtps_pd(hue), _mm_cvtps_pd(c)),
+                        x_of(_mm_cvtps_pd(_mm_movehl_ps(hue, hue)),
+                             _mm_cvtps_pd(_mm_movehl_ps(c, c))));
+                    __m128 m = _mm_sub_ps(value, c);
+
+                    // Sector k of the hue is where from[k - 1] is set but from[k] is not
+                    __m128 from60 = _mm_cmpge_ps(hue, _mm_set1_ps(60));
+                    __m128 from120 = _mm_cmpge_ps(hue, _mm_set1_ps(120));
+                    __m128 from180 = _mm_cmpge_ps(hue, _mm_set1_ps(180));
+                    __m128 from240 = _mm_cmpge_ps(hue, _mm_set1_ps(240));
+                    __m128 from300 = _mm_cmpge_ps(hue, _mm_set1_ps(300));
+                    __m128 sector1 = _mm_xor_ps(from60, from120);
+                    __m128 sector2 = _mm_xor_ps(from120, from180);
+                    __m128 sector3 = _mm_xor_ps(from180, from240);
+                    __m128 sector4 = _mm_xor_ps(from240, from300);
+                    __m128 r = _mm_or_ps(
+                        _mm_or_ps(_mm_andnot_ps(from60, c), _mm_and_ps(from300, c)),
+                        _mm_and_ps(_mm_or_ps(sector1, sector4), x));
+                    __m128 g = _mm_or_ps(
+                        _mm_and_ps(_mm_or_ps(sector1, sector2), c),
+                        _mm_or_ps(_mm_andnot_ps(from60, x), _mm_and_ps(sector3, x)));
+                    __m128 b = _mm_or_ps(_mm_and_ps(_mm_or_ps(sector3, sector4), c),
+                                         _mm_and_ps(_mm_or_ps(sector2, from300), x));
+
+                    __m128i pixels = _mm_or_si128(
+                        _mm_or_si128(to_byte(r, m), _mm_slli_epi32(to_byte(g, m), 8)),
+                        _mm_or_si128(_mm_slli_epi32(to_byte(b, m), 16), alpha));
+                    if (channels == 4) {
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(rgb), pixels);
+                        continue;
+                    }
+                    // Close the gaps left by the alpha bytes: first within each pair of pixels,
+                    // then between the pairs
+                    __m128i pairs = _mm_or_si128(
+                        _mm_and_si128(pixels, _mm_set_epi32(0, 0xFFFFFF, 0, 0xFFFFFF)),
+                        _mm_and_si128(_mm_srli_epi64(pixels, 8),
+                                      _mm_set_epi32(0xFFFF, 0xFF000000, 0xFFFF, 0xFF000000)));
+                    __m128i packed = _mm_or_si128(
+                        _mm_move_epi64(pairs),
+                        _mm_and_si128(_mm_srli_si128(pairs, 2),
+                                      _mm_set_epi32(0, -1, static_cast<int>(0xFFFF0000), 0)));
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(rgb), packed);
+                    std::uint32_t last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+                    std::memcpy(rgb + 8, &last, sizeof last);
+                }
+                convert_scalar(hues + i * stride, saturations + i * stride, values + i * stride,
+                               stride, count - i, rgb, format);
+            }
+        }  // namespace sse2
+
+        namespace avx2 {
+            __attribute__((target("avx2"))) __m128 x_of(__m256d hue, __m256d c) {
+                __m256d sixths = _mm256_div_pd(hue, _mm256_set1_pd(60.0));
+                __m256d twos = _mm256_floor_pd(_mm256_mul_pd(sixths, _mm256_set1_pd(0.5)));
+                __m256d remainder = _mm256_sub_pd(sixths, _mm256_add_pd(twos, twos));
+                __m256d distance = _mm256_andnot_pd(_mm256_set1_pd(-0.0),
+                                                    _mm256_sub_pd(remainder,
+                                                                  _mm256_set1_pd(1.0)));
+                return _mm256_cvtpd_ps(
+                    _mm256_mul_pd(c, _mm256_sub_pd(_mm256_set1_pd(1.0), distance)));
+            }
+
+            __attribute__((target("avx2"))) __m256i to_byte(__m256 component, __m256 m) {
+                __m256 scaled = _mm256_mul_ps(_mm256_add_ps(component, m), _mm256_set1_ps(255));
+                __m256 whole = _mm256_floor_ps(scaled);
+                __m256 round_up = _mm256_cmp_ps(_mm256_sub_ps(scaled, whole),
+                                                _mm256_set1_ps(0.5f), _CMP_GE_OQ);
+                return _mm256_sub_epi32(_mm256_cvttps_epi32(whole),
+                                        _mm256_castps_si256(round_up));
+            }
+
+            // Eight colors, from planes or interleaved. Blending gathers each component of
+            // interleaved colors out of order, and permuting restores the order.
+            __attribute__((target("avx2"))) void load(const float *hues,
+                                                      const float *saturations,
+                                                      const float *values, std::size_t stride,
+                                                      __m256 &hue, __m256 &saturation,
+                                                      __m256 &value) {
+                if (stride == 1) {
+                    hue = _mm256_loadu_ps(hues);
+                    saturation = _mm256_loadu_ps(saturations);
+                    value = _mm256_loadu_ps(values);
+                    return;
+                }
+                __m256 a = _mm256_loadu_ps(hues), b = _mm256_loadu_ps(hues + 8);
+                __m256 c = _mm256_loadu_ps(hues + 16);
+                hue = _mm256_permutevar8x32_ps(
+                    _mm256_blend_ps(_mm256_blend_ps(a, b, 0x92), c, 0x24),
+                    _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+                saturation = _mm256_permutevar8x32_ps(
+                    _mm256_blend_ps(_mm256_blend_ps(a, b, 0x24), c, 0x49),
+                    _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6));
+                value = _mm256_permutevar8x32_ps(
+                    _mm256_blend_ps(_mm256_blend_ps(a, b, 0x49), c, 0x92),
+                    _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+            }
+
+            __attribute__((target("avx2"))) __m256 in_range(__m256 component, float high) {
+                return _mm256_and_ps(_mm256_cmp_ps(component, _mm256_setzero_ps(), _CMP_GE_OQ),
+                                     _mm256_cmp_ps(component, _mm256_set1_ps(high), _CMP_LE_OQ));
+            }
+
+            __attribute__((target("avx2"))) __m256 from(__m256 hue, float degrees) {
+                return _mm256_cmp_ps(hue, _mm256_set1_ps(degrees), _CMP_GE_OQ);
+            }
+
+            // Eight pixels of RGBA in 32-bit lanes, stored whole or without their alpha bytes
+            __attribute__((target("avx2"))) void store(__m256i pixels, std::size_t channels,
+                                                       std::uint8_t *rgb) {
+                if (channels == 4) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(rgb), pixels);
+                    return;
+                }
+                // 12 bytes in each lane, the first lane's store being overlapped by the second
+                const __m256i close_gaps = _mm256_setr_epi8(
+                    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+                __m256i packed = _mm256_shuffle_epi8(pixels, close_gaps);
+                __m128i high = _mm256_extracti128_si256(packed, 1);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(rgb), _mm256_castsi256_si128(packed));
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(rgb + 12), high);
+                std::uint32_t last = _mm_cvtsi128_si32(_mm_srli_si128(high, 8));
+                std::memcpy(rgb + 20, &last, sizeof last);
+            }
+
+            // Eight colors at a time, as in sse2::convert
+            __attribute__((target("avx2"))) void convert(const float *hues,
+                                                         const float *saturations,
+                                                         const float *values, std::size_t stride,
+                                                         std::size_t count, std::uint8_t *rgb,
+                                                         RgbFormat format) {
+                const std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+                const __m256i alpha = _mm256_set1_epi32(channels == 4 ? 0xFF000000 : 0);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8, rgb += 8 * channels) {
+                    __m256 hue, saturation, value;
+                    load(hues + i * stride, saturations + i * stride, values + i * stride, stride,
+                         hue, saturation, value);
+                    __m256 valid = _mm256_and_ps(in_range(hue, 360), _mm256_and_ps(
+                        in_range(saturation, 1), in_range(value, 1)));
+                    if (_mm256_movemask_ps(valid) != 0xFF) {
+                        break;
+                    }
+                    __m256 c = _mm256_mul_ps(value, saturation);
+                    __m256 x = _mm256_set_m128(
+                        x_of(_mm256_cvtps_pd(_mm256_extractf128_ps(hue, 1)),
+                             _mm256_cvtps_pd(_mm256_extractf128_ps(c, 1))),
+                        x_of(_mm256_cvtps_pd(_mm256_castps256_ps128(hue)),
+                             _mm256_cvtps_pd(_mm256_castps256_ps128(c))));
+                    __m256 m = _mm256_sub_ps(value, c);
+
+                    __m256 from60 = from(hue, 60), from300 = from(hue, 300);
+                    __m256 from120 = from(hue, 120), from180 = from(hue, 180);
+                    __m256 from240 = from(hue, 240);
+                    __m256 sector1 = _mm256_xor_ps(from60, from120);
+                    __m256 sector2 = _mm256_xor_ps(from120, from180);
+                    __m256 sector3 = _mm256_xor_ps(from180, from240);
+                    __m256 sector4 = _mm256_xor_ps(from240, from300);
+                    __m256 r = _mm256_or_ps(
+                        _mm256_or_ps(_mm256_andnot_ps(from60, c), _mm256_and_ps(from300, c)),
+                        _mm256_and_ps(_mm256_or_ps(sector1, sector4), x));
+                    __m256 g = _mm256_or_ps(
+                        _mm256_and_ps(_mm256_or_ps(sector1, sector2), c),
+                        _mm256_or_ps(_mm256_andnot_ps(from60, x), _mm256_and_ps(sector3, x)));
+                    __m256 b = _mm256_or_ps(_mm256_and_ps(_mm256_or_ps(sector3, sector4), c),
+                                            _mm256_and_ps(_mm256_or_ps(sector2, from300), x));
+
+                    __m256i pixels = _mm256_or_si256(
+                        _mm256_or_si256(to_byte(r, m), _mm256_slli_epi32(to_byte(g, m), 8)),
+                        _mm256_or_si256(_mm256_slli_epi32(to_byte(b, m), 16), alpha));
+                    store(pixels, channels, rgb);
+                }
+                convert_scalar(hues + i * stride, saturations + i * stride, values + i * stride,
+                               stride, count - i, rgb, format);
+            }
+        }  // namespace avx2
+#endif
+
+        // The widest kernel the running CPU supports, chosen at first use
+        Converter converter() {
+#ifdef CS19_HSV_COLOR_X86
+            static const Converter best =
+                __builtin_cpu_supports("avx2") ? avx2::convert : sse2::convert;
+            return best;
+#else
+            return convert_scalar;
+#endif
+        }
+
+        // The reverse conversions read 8-bit RGB pixels and write the components of each color to
+        // hues, saturations and values at multiples of stride, as above. The value is the largest
+        // component and the saturation the share of it that the smallest lacks. The hue is 60°
+        // times how far the other two components differ, over the difference between the largest
+        // and smallest, added to 0°, 120° or 240° for a largest red, green or blue. The one
+        // rounding of that division keeps every one of the 2^24 colors exact on the way back.
+        // The vector kernels work in float throughout, where the components and their
+        // differences are exact, so they round like the scalar code.
+        using HsvConverter = void (*)(const std::uint8_t *rgb, std::size_t count, RgbFormat format,
+                                      float *hues, float *saturations, float *values,
+                                      std::size_t stride);
+
+        void hsv_of(int red, int green, int blue, float &hue, float &saturation, float &value) {
+            int largest = std::max(red, std::max(green, blue));
+            int delta = largest - std::min(red, std::min(green, blue));
+            int difference = red == largest ? green - blue
+                           : green == largest ? blue - red : red - green;
+            float base = red == largest ? 0 : green == largest ? 120 : 240;
+            value = largest / 255.0f;
+            saturation = largest ? static_cast<float>(delta) / static_cast<float>(largest) : 0;
+            hue = delta ? 60.0f * difference / static_cast<float>(delta) + base : 0;
+            if (hue < 0) {
+                hue += 360;
+            }
+        }
+
+        void to_hsv_scalar(const std::uint8_t *rgb, std::size_t count, RgbFormat format,
+                           float *hues, float *saturations, float *values, std::size_t stride) {
+            std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+            for (std::size_t i = 0; i < count * stride; i += stride, rgb += channels) {
+                hsv_of(rgb[0], rgb[1], rgb[2], hues[i], saturations[i], values[i]);
+            }
+        }
+
+#ifdef CS19_HSV_COLOR_X86
+        namespace sse2 {
+            void hsv_of(__m128 red, __m128 green, __m128 blue, __m128 &hue, __m128 &saturation,
+                        __m128 &value) {
+                __m128 largest = _mm_max_ps(red, _mm_max_ps(green, blue));
+                __m128 delta = _mm_sub_ps(largest, _mm_min_ps(red, _mm_min_ps(green, blue)));
+                __m128 red_largest = _mm_cmpeq_ps(red, largest);
+                __m128 green_largest = _mm_andnot_ps(red_largest, _mm_cmpeq_ps(green, largest));
+                __m128 blue_largest = _mm_andnot_ps(_mm_or_ps(red_largest, green_largest),
+                                                    _mm_cmpeq_ps(blue, largest));
+                __m128 difference = _mm_or_ps(
+                    _mm_and_ps(red_largest, _mm_sub_ps(green, blue)),
+                    _mm_or_ps(_mm_and_ps(green_largest, _mm_sub_ps(blue, red)),
+                              _mm_and_ps(blue_largest, _mm_sub_ps(red, green))));
+                __m128 base = _mm_or_ps(_mm_and_ps(green_largest, _mm_set1_ps(120)),
+                                        _mm_and_ps(blue_largest, _mm_set1_ps(240)));
+                value = _mm_div_ps(largest, _mm_set1_ps(255));
+                // The divisions by 0 of black and grays are masked off
+                saturation = _mm_and_ps(_mm_cmpneq_ps(largest, _mm_setzero_ps()),
+                                        _mm_div_ps(delta, largest));
+                hue = _mm_and_ps(_mm_cmpneq_ps(delta, _mm_setzero_ps()),
+                                 _mm_add_ps(_mm_div_ps(_mm_mul_ps(difference, _mm_set1_ps(60)),
+                                                       delta),
+                                            base));
+                hue = _mm_add_ps(hue, _mm_and_ps(_mm_cmplt_ps(hue, _mm_setzero_ps()),
+                                                 _mm_set1_ps(360)));
+            }
+
+            // Four pixels at a time; without byte shuffles, packed pixels are loaded one by one
+            void to_hsv(const std::uint8_t *rgb, std::size_t count, RgbFormat format,
+                        float *hues, float *saturations, float *values, std::size_t stride) {
+                const std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+                std::size_t i = 0;
+                for (; i + 4 <= count; i += 4, rgb += 4 * channels) {
+                    __m128i red, green, blue;
+                    if (channels == 4) {
+                        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb));
+                        __m128i byte = _mm_set1_epi32(0xFF);
+                        red = _mm_and_si128(pixels, byte);
+                        green = _mm_and_si128(_mm_srli_epi32(pixels, 8), byte);
+                        blue = _mm_and_si128(_mm_srli_epi32(pixels, 16), byte);
+                    } else {
+                        red = _mm_setr_epi32(rgb[0], rgb[3], rgb[6], rgb[9]);
+                        green = _mm_setr_epi32(rgb[1], rgb[4], rgb[7], rgb[10]);
+                        blue = _mm_setr_epi32(rgb[2], rgb[5], rgb[8], rgb[11]);
+                    }
+                    __m128 hue, saturation, value;
+                    hsv_of(_mm_cvtepi32_ps(red), _mm_cvtepi32_ps(green), _mm_cvtepi32_ps(blue),
+                           hue, saturation, value);
+                    if (stride == 1) {
+                        _mm_storeu_ps(hues + i, hue);
+                        _mm_storeu_ps(saturations + i, saturation);
+                        _mm_storeu_ps(values + i, value);
+                        continue;
+                    }
+                    float components[3][4];
+                    _mm_storeu_ps(components[0], hue);
+                    _mm_storeu_ps(components[1], saturation);
+                    _mm_storeu_ps(components[2], value);
+                    for (std::size_t k = 0; k < 4; ++k) {
+                        hues[(i + k) * stride] = components[0][k];
+                        saturations[(i + k) * stride] = components[1][k];
+                        values[(i + k) * stride] = components[2][k];
+                    }
+                }
+                to_hsv_scalar(rgb, count - i, format, hues + i * stride,
+                              saturations + i * stride, values + i * stride, stride);
+            }
+        }  // namespace sse2
+
+        namespace avx2 {
+            __attribute__((target("avx2"))) void hsv_of(__m256 red, __m256 green, __m256 blue,
+                                                        __m256 &hue, __m256 &saturation,
+                                                        __m256 &value) {
+                __m256 largest = _mm256_max_ps(red, _mm256_max_ps(green, blue));
+                __m256 delta = _mm256_sub_ps(largest,
+                                             _mm256_min_ps(red, _mm256_min_ps(green, blue)));
+                __m256 red_largest = _mm256_cmp_ps(red, largest, _CMP_EQ_OQ);
+                __m256 green_largest = _mm256_andnot_ps(
+                    red_largest, _mm256_cmp_ps(green, largest, _CMP_EQ_OQ));
+                __m256 blue_largest = _mm256_andnot_ps(
+                    _mm256_or_ps(red_largest, green_largest),
+                    _mm256_cmp_ps(blue, largest, _CMP_EQ_OQ));
+                __m256 difference = _mm256_or_ps(
+                    _mm256_and_ps(red_largest, _mm256_sub_ps(green, blue)),
+                    _mm256_or_ps(_mm256_and_ps(green_largest, _mm256_sub_ps(blue, red)),
+                                 _mm256_and_ps(blue_largest, _mm256_sub_ps(red, green))));
+                __m256 base = _mm256_or_ps(_mm256_and_ps(green_largest, _mm256_set1_ps(120)),
+                                           _mm256_and_ps(blue_largest, _mm256_set1_ps(240)));
+                value = _mm256_div_ps(largest, _mm256_set1_ps(255));
+                saturation = _mm256_and_ps(
+                    _mm256_cmp_ps(largest, _mm256_setzero_ps(), _CMP_NEQ_OQ),
+                    _mm256_div_ps(delta, largest));
+                hue = _mm256_and_ps(
+                    _mm256_cmp_ps(delta, _mm256_setzero_ps(), _CMP_NEQ_OQ),
+                    _mm256_add_ps(
+                        _mm256_div_ps(_mm256_mul_ps(difference, _mm256_set1_ps(60)), delta),
+                        base));
+                hue = _mm256_add_ps(
+                    hue, _mm256_and_ps(_mm256_cmp_ps(hue, _mm256_setzero_ps(), _CMP_LT_OQ),
+                                       _mm256_set1_ps(360)));
+            }
+
+            // Eight pixels at a time, spreading the bytes of each component over 32-bit lanes by
+            // shuffling; interleaved colors are stored by the inverse of load()'s permutation
+            __attribute__((target("avx2"))) void to_hsv(const std::uint8_t *rgb,
+                                                        std::size_t count, RgbFormat format,
+                                                        float *hues, float *saturations,
+                                                        float *values, std::size_t stride) {
+                const std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+                // Packed pixels 4 to 7 start 4 bytes into the second lane, loaded from byte 8
+                const __m256i spread_red = _mm256_setr_epi8(
+                    0, -1, -1, -1, 3, -1, -1, -1, 6, -1, -1, -1, 9, -1, -1, -1,
+                    4, -1, -1, -1, 7, -1, -1, -1, 10, -1, -1, -1, 13, -1, -1, -1);
+                const __m256i one = _mm256_set1_epi32(1), byte = _mm256_set1_epi32(0xFF);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8, rgb += 8 * channels) {
+                    __m256i red, green, blue;
+                    if (channels == 4) {
+                        __m256i pixels = _mm256_loadu_si256(
+                            reinterpret_cast<const __m256i *>(rgb));
+                        red = _mm256_and_si256(pixels, byte);
+                        green = _mm256_and_si256(_mm256_srli_epi32(pixels, 8), byte);
+                        blue = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), byte);
+                    } else {
+                        __m256i pixels = _mm256_set_m128i(
+                            _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb + 8)),
+                            _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb)));
+                        // Adding 1 to the index in the low byte of each lane of the shuffle moves
+                        // on to the next component, while the -1s go on zeroing the other bytes
+                        __m256i spread_green = _mm256_add_epi8(spread_red, one);
+                        __m256i spread_blue = _mm256_add_epi8(spread_green, one);
+                        red = _mm256_shuffle_epi8(pixels, spread_red);
+                        green = _mm256_shuffle_epi8(pixels, spread_green);
+                        blue = _mm256_shuffle_epi8(pixels, spread_blue);
+                    }
+                    __m256 hue, saturation, value;
+                    hsv_of(_mm256_cvtepi32_ps(red), _mm256_cvtepi32_ps(green),
+                           _mm256_cvtepi32_ps(blue), hue, saturation, value);
+                    if (stride == 1) {
+                        _mm256_storeu_ps(hues + i, hue);
+                        _mm256_storeu_ps(saturations + i, saturation);
+                        _mm256_storeu_ps(values + i, value);
+                        continue;
+                    }
+                    hue = _mm256_permutevar8x32_ps(hue, _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5));
+                    saturation = _mm256_permutevar8x32_ps(
+                        saturation, _mm256_setr_epi32(5, 0, 3, 6, 1, 4, 7, 2));
+                    value = _mm256_permutevar8x32_ps(value,
+                                                     _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7));
+                    float *out = hues + i * stride;
+                    _mm256_storeu_ps(out, _mm256_blend_ps(_mm256_blend_ps(hue, saturation, 0x92),
+                                                          value, 0x24));
+                    _mm256_storeu_ps(out + 8, _mm256_blend_ps(
+                        _mm256_blend_ps(hue, saturation, 0x24), value, 0x49));
+                    _mm256_storeu_ps(out + 16, _mm256_blend_ps(
+                        _mm256_blend_ps(hue, saturation, 0x49), value, 0x92));
+                }
+                to_hsv_scalar(rgb, count - i, format, hues + i * stride,
+                              saturations + i * stride, values + i * stride, stride);
+            }
+        }  // namespace avx2
+#endif
+
+        HsvConverter hsv_converter() {
+#ifdef CS19_HSV_COLOR_X86
+            static const HsvConverter best =
+                __builtin_cpu_supports("avx2") ? avx2::to_hsv : sse2::to_hsv;
+            return best;
+#else
+            return to_hsv_scalar;
+#endif
+        }
+
+        constexpr std::size_t BLOCK = 256;  // colors copied to and from HsvColor arrays at a time
+    }  // namespace
+
+    HsvColor HsvColor::from_rgb(int red, int green, int blue) {
+        if (red < 0 || red > 255 || green < 0 || green > 255 || blue < 0 || blue > 255) {
+            throw std::domain_error("Parameter out of range");
+        }
+        float hue, saturation, value;
+        hsv_of(red, green, blue, hue, saturation, value);
+        return HsvColor(hue, saturation, value);
+    }
+
+    void hsv_to_rgb(const float *hues, const float *saturations, const float *values,
+                    std::size_t count, std::uint8_t *rgb, RgbFormat format) {
+        converter()(hues, saturations, values, 1, count, rgb, format);
+    }
+
+    void hsv_to_rgb(const float *hsv, std::size_t count, std::uint8_t *rgb, RgbFormat format) {
+        converter()(hsv, hsv + 1, hsv + 2, 3, count, rgb, format);
+    }
+
+    // Colors are copied as interleaved floats, which is all an HsvColor holds, in blocks that stay
+    // in L1 cache
+    void hsv_to_rgb(const HsvColor *colors, std::size_t count, std::uint8_t *rgb,
+                    RgbFormat format) {
+        float hsv[3 * BLOCK];
+        std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+        for (std::size_t start = 0; start < count; start += BLOCK) {
+            std::size_t size = std::min(BLOCK, count - start);
+            std::memcpy(hsv, colors + start, size * sizeof(HsvColor));
+            converter()(hsv, hsv + 1, hsv + 2, 3, size, rgb + start * channels, format);
+        }
+    }
+
+    void rgb_to_hsv(const std::uint8_t *rgb, std::size_t count, float *hues, float *saturations,
+                    float *values, RgbFormat format) {
+        hsv_converter()(rgb, count, format, hues, saturations, values, 1);
+    }
+
+    void rgb_to_hsv(const std::uint8_t *rgb, std::size_t count, HsvColor *colors,
+                    RgbFormat format) {
+        float hsv[3 * BLOCK];
+        std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+        for (std::size_t start = 0; start < count; start += BLOCK) {
+            std::size_t size = std::min(BLOCK, count - start);
+            hsv_converter()(rgb + start * channels, size, format, hsv, hsv + 1, hsv + 2, 3);
+            std::memcpy(colors + start, hsv, size * sizeof(HsvColor));
+        }
+    }
+
+    namespace {
+        constexpr std::uint64_t LUT_MAGIC = 0x3154554c56534831;  // "1HSVLUT1" little-endian
+        constexpr std::size_t LUT_EXTREMES = 8;  // the offset of the extremes, after the magic
+        constexpr std::size_t LUT_MIDDLES = LUT_EXTREMES + 2 * HsvLut::LEVELS * HsvLut::LEVELS;
+        constexpr std::size_t LUT_BYTES =
+            LUT_MIDDLES + std::size_t{HsvLut::HUES} * HsvLut::LEVELS * HsvLut::LEVELS;
+
+        // The sector of each whole degree of hue, as component() chooses it
+        struct Sectors {
+            std::uint8_t of[HsvLut::HUES] {};
+        };
+
+        constexpr Sectors make_sectors() {
+            Sectors sectors;
+            for (int hue = 0; hue < HsvLut::HUES; ++hue) {
+                sectors.of[hue] = static_cast<std::uint8_t>((hue >= 60) + (hue >= 120) +
+                                                            (hue >= 180) + (hue >= 240) +
+                                                            (hue >= 300));
+            }
+            return sectors;
+        }
+
+        constexpr Sectors SECTORS = make_sectors();
+
+        // The components of a color: the largest and smallest by its saturation and value, the
+        // middle one also by its hue, and the sector of the hue deciding which is which
+        void look_up(const std::uint8_t *extremes, const std::uint8_t *middles, int hue,
+                     int saturation, int value, std::uint8_t *rgb) {
+            std::size_t level = saturation * HsvLut::LEVELS + value;
+            const std::uint8_t shares[3] = {extremes[2 * level + 1],
+                                            middles[level * HsvLut::HUES + hue],
+                                            extremes[2 * level]};  // indexed by Share
+            const Share *sector = SECTOR_SHARES[SECTORS.of[hue]];
+            rgb[0] = shares[sector[0]];
+            rgb[1] = shares[sector[1]];
+            rgb[2] = shares[sector[2]];
+        }
+
+        using LutConverter = void (*)(const std::uint8_t *extremes, const std::uint8_t *middles,
+                                      const std::uint16_t *hues, const std::uint8_t *saturations,
+                                      const std::uint8_t *values, std::size_t count,
+                                      std::uint8_t *rgb, RgbFormat format);
+
+        void look_up_scalar(const std::uint8_t *extremes, const std::uint8_t *middles,
+                            const std::uint16_t *hues, const std::uint8_t *saturations,
+                            const std::uint8_t *values, std::size_t count, std::uint8_t *rgb,
+                            RgbFormat format) {
+            std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+            for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+                if (hues[i] >= HsvLut::HUES || saturations[i] >= HsvLut::LEVELS ||
+                    values[i] >= HsvLut::LEVELS) {
+                    throw std::domain_error("Parameter out of range");
+                }
+                look_up(extremes, middles, hues[i], saturations[i], values[i], rgb);
+                if (channels == 4) {
+                    rgb[3] = 255;
+                }
+            }
+        }
+
+#ifdef CS19_HSV_COLOR_X86
+        namespace avx2 {
+            __attribute__((target("avx2"))) __m256i from(__m256i hue, int degrees) {
+                return _mm256_cmpgt_epi32(hue, _mm256_set1_epi32(degrees - 1));
+            }
+
+            // Eight colors at a time, checked as a block: one gather fetches the largest and
+            // smallest components of each and another the middle one, and masks of the hue's
+            // sector, as in convert, blend them into place. A block with a color out of range is
+            // left to the scalar loop, which throws at that color.
+            __attribute__((target("avx2"))) void look_up(const std::uint8_t *extremes,
+                                                         const std::uint8_t *middles,
+                                                         const std::uint16_t *hues,
+                                                         const std::uint8_t *saturations,
+                                                         const std::uint8_t *values,
+                                                         std::size_t count, std::uint8_t *rgb,
+                                                         RgbFormat format) {
+                const std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+                const __m256i alpha = _mm256_set1_epi32(channels == 4 ? 0xFF000000 : 0);
+                const __m256i low_byte = _mm256_set1_epi32(0xFF);
+                const __m256i last_hue = _mm256_set1_epi32(HsvLut::HUES - 1);
+                const __m256i last_level = _mm256_set1_epi32(HsvLut::LEVELS - 1);
+                // Each pair of extremes is gathered with the next two bytes, and each middle
+                // component with the three bytes before it, so no gather reads outside the table
+                const auto *extreme_pairs = reinterpret_cast<const int *>(extremes);
+                const auto *middle_ends = reinterpret_cast<const int *>(middles - 3);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8, rgb += 8 * channels) {
+                    __m256i hue = _mm256_cvtepu16_epi32(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(hues + i)));
+                    __m256i saturation = _mm256_cvtepu8_epi32(
+                        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(saturations + i)));
+                    __m256i value = _mm256_cvtepu8_epi32(
+                        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(values + i)));
+                    __m256i invalid = _mm256_or_si256(
+                        _mm256_cmpgt_epi32(hue, last_hue),
+                        _mm256_or_si256(_mm256_cmpgt_epi32(saturation, last_level),
+                                        _mm256_cmpgt_epi32(value, last_level)));
+                    if (!_mm256_testz_si256(invalid, invalid)) {
+                        break;
+                    }
+                    __m256i level = _mm256_add_epi32(
+                        _mm256_mullo_epi32(saturation, _mm256_set1_epi32(HsvLut::LEVELS)), value);
+                    __m256i pair = _mm256_i32gather_epi32(extreme_pairs,
+                                                          _mm256_add_epi32(level, level), 1);
+                    __m256i largest = _mm256_and_si256(pair, low_byte);
+                    __m256i smallest = _mm256_and_si256(_mm256_srli_epi32(pair, 8), low_byte);
+                    __m256i entry = _mm256_add_epi32(
+                        _mm256_mullo_epi32(level, _mm256_set1_epi32(HsvLut::HUES)), hue);
+                    __m256i middle = _mm256_srli_epi32(
+                        _mm256_i32gather_epi32(middle_ends, entry, 1), 24);
+
+                    __m256i from60 = from(hue, 60), from120 = from(hue, 120);
+                    __m256i from180 = from(hue, 180), from240 = from(hue, 240);
+                    __m256i from300 = from(hue, 300);
+                    __m256i r = _mm256_blendv_epi8(
+                        _mm256_blendv_epi8(largest, smallest, _mm256_xor_si256(from120, from240)),
+                        middle, _mm256_or_si256(_mm256_xor_si256(from60, from120),
+                                                _mm256_xor_si256(from240, from300)));
+                    __m256i g = _mm256_blendv_epi8(_mm256_blendv_epi8(middle, smallest, from240),
+                                                   largest, _mm256_xor_si256(from60, from180));
+                    __m256i b = _mm256_blendv_epi8(_mm256_blendv_epi8(smallest, middle, from120),
+                                                   largest, _mm256_xor_si256(from180, from300));
+
+                    __m256i pixels = _mm256_or_si256(
+                        _mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+                        _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+                    store(pixels, channels, rgb);
+                }
+                look_up_scalar(extremes, middles, hues + i, saturations + i, values + i,
+                               count - i, rgb, format);
+            }
+        }  // namespace avx2
+#endif
+
+        // The AVX2 kernel if the running CPU supports it; SSE2 has no gathers
+        LutConverter lut_converter() {
+#ifdef CS19_HSV_COLOR_X86
+            static const LutConverter best =
+                __builtin_cpu_supports("avx2") ? avx2::look_up : look_up_scalar;
+            return best;
+#else
+            return look_up_scalar;
+#endif
+        }
+    }
+
+    // A read-only mapping of a saved table, unmapped with the table
+    struct HsvLut::Mapping {
+        void *data = nullptr;
+        std::size_t size = 0;
+
+        explicit Mapping(const std::string &path) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "open " + path);
+            }
+            struct stat info;
+            if (::fstat(fd, &info) < 0) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "fstat " + path);
+            }
+            if (static_cast<std::size_t>(info.st_size) != LUT_BYTES) {
+                ::close(fd);
+                throw std::domain_error("Not a valid HSV lookup table file");
+            }
+            data = ::mmap(nullptr, LUT_BYTES, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "mmap " + path);
+            }
+            size = LUT_BYTES;
+            ::close(fd);  // the mapping remains valid after the descriptor is closed
+        }
+
+        Mapping(const Mapping &) = delete;
+        Mapping &operator=(const Mapping &) = delete;
+
+        ~Mapping() {
+            ::munmap(data, size);
+        }
+    };
+
+    // Each table entry is converted from the same floats as the quantized hsv_to_rgb() converts,
+    // a row of every hue for each saturation and value at a time; the row gives the largest and
+    // smallest components as well as the middle one of each hue
+    HsvLut::HsvLut() : table_(LUT_BYTES) {
+        std::memcpy(table_.data(), &LUT_MAGIC, sizeof LUT_MAGIC);
+        std::uint8_t *extremes = table_.data() + LUT_EXTREMES;
+        std::uint8_t *middles = table_.data() + LUT_MIDDLES;
+        float hues[HUES], saturations[HUES], values[HUES];
+        std::uint8_t rgb[3 * HUES];
+        for (int hue = 0; hue < HUES; ++hue) {
+            hues[hue] = static_cast<float>(hue);
+        }
+        for (int saturation = 0; saturation < LEVELS; ++saturation) {
+            for (int value = 0; value < LEVELS; ++value) {
+                std::fill_n(saturations, HUES, saturation / 100.0f);
+                std::fill_n(values, HUES, value / 100.0f);
+                converter()(hues, saturations, values, 1, HUES, rgb, RgbFormat::RGB8);
+                std::size_t level = saturation * LEVELS + value;
+                extremes[2 * level] = rgb[0];      // red gets C at hue 0
+                extremes[2 * level + 1] = rgb[2];  // and blue gets none
+                for (int hue = 0; hue < HUES; ++hue) {
+                    const Share *shares = SECTOR_SHARES[SECTORS.of[hue]];
+                    int channel = std::find(shares, shares + 3, SECOND_LARGEST) - shares;
+                    middles[level * HUES + hue] = rgb[3 * hue + channel];
+                }
+            }
+        }
+        extremes_ = extremes;
+        middles_ = middles;
+    }
+
+    HsvLut::HsvLut(std::unique_ptr<Mapping> mapping) : mapping_(std::move(mapping)) {}
+
+    HsvLut::HsvLut(HsvLut &&that) noexcept = default;
+    HsvLut &HsvLut::operator=(HsvLut &&that) noexcept = default;
+    HsvLut::~HsvLut() = default;
+
+    HsvLut HsvLut::load(const std::string &path) {
+        auto mapping = std::make_unique<Mapping>(path);
+        const auto *data = static_cast<const std::uint8_t *>(mapping->data);
+        std::uint64_t magic;
+        std::memcpy(&magic, data, sizeof magic);
+        if (magic != LUT_MAGIC) {
+            throw std::domain_error("Not a valid HSV lookup table file");
+        }
+        HsvLut lut(std::move(mapping));
+        lut.extremes_ = data + LUT_EXTREMES;
+        lut.middles_ = data + LUT_MIDDLES;
+        return lut;
+    }
+
+    void HsvLut::save(const std::string &path) const {
+        std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path.c_str(), "wb"),
+                                                               std::fclose);
+        const std::uint8_t *data = extremes_ - LUT_EXTREMES;
+        if (!file || std::fwrite(data, 1, LUT_BYTES, file.get()) != LUT_BYTES ||
+            std::fflush(file.get()) != 0) {
+            throw std::system_error(errno, std::generic_category(), "write " + path);
+        }
+    }
+
+    std::size_t HsvLut::size_bytes() const {
+        return LUT_BYTES;
+    }
+
+    void HsvLut::lookup(int hue, int saturation, int value, std::uint8_t *rgb) const {
+        look_up(extremes_, middles_, hue, saturation, value, rgb);
+    }
+
+    void HsvLut::lookup(const std::uint16_t *hues, const std::uint8_t *saturations,
+                        const std::uint8_t *values, std::size_t count, std::uint8_t *rgb,
+                        RgbFormat format) const {
+        lut_converter()(extremes_, middles_, hues, saturations, values, count, rgb, format);
+    }
+
+    // Without a table, the colors are converted to floats and computed a block at a time
+    void hsv_to_rgb(const std::uint16_t *hues, const std::uint8_t *saturations,
+                    const std::uint8_t *values, std::size_t count, std::uint8_t *rgb,
+                    RgbFormat format, const HsvLut *lut) {
+        std::size_t channels = format == RgbFormat::RGBA8 ? 4 : 3;
+        if (lut) {
+            lut->lookup(hues, saturations, values, count, rgb, format);
+            return;
+        }
+        float hsv[3 * BLOCK];
+        for (std::size_t start = 0; start < count; start += BLOCK) {
+            std::size_t size = std::min(BLOCK, count - start);
+            for (std::size_t i = 0; i < size; ++i) {
+                hsv[i] = hues[start + i];
+                hsv[BLOCK + i] = saturations[start + i] / 100.0f;
+                hsv[2 * BLOCK + i] = values[start + i] / 100.0f;
+            }
+            converter()(hsv, hsv + BLOCK, hsv + 2 * BLOCK, 1, size, rgb + start * channels, format);
+        }
+    }
+
+    // The colors are converted to RGB a block at a time
+    std::to_chars_result format_colors(const HsvColor *colors, std::size_t count, char *first,
+                                       char *last, ColorNotation notation, char separator) {
+        std::uint8_t rgb[3 * BLOCK];
+        char *out = first;
+        for (std::size_t start = 0; start < count; start += BLOCK) {
+            std::size_t size = std::min(BLOCK, count - start);
+            hsv_to_rgb(colors + start, size, rgb);
+            for (const std::uint8_t *color = rgb; color != rgb + 3 * size; color += 3) {
+                std::size_t length = notation == ColorNotation::HEX ? HsvColor::HEX_STRING_LENGTH
+                                                                    : rgb_length(color);
+                if (static_cast<std::size_t>(last - out) <= length) {
+                    return {last, std::errc::value_too_large};
+                }
+                out = notation == ColorNotation::HEX ? write_hex(out, color)
+                                                     : write_rgb(out, color);
+                *out++ = separator;
+            }
+        }
+        return {out, std::errc()};
     }
 }  // namespace cs19
\ No newline at end of file
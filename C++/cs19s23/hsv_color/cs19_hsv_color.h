@@ -1,17 +1,39 @@
 #ifndef CS19_HSV_COLOR_H_
 #define CS19_HSV_COLOR_H_
 
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 namespace cs19 {
     /**
      * Represents an immutable HSV (hue, saturation, value) color where each of the three components is 
      * represented as a float. Offers a few overloaded operators and other functions, including several 
      * related to converting a HSV color to its equivalent 24-bit RGB components.
+     *
+     * Only the three components are stored, so a color takes 12 bytes and is trivially copyable,
+     * fit for large arrays; its RGB components are derived whenever they are read.
     */
     class HsvColor {
         public:
-            HsvColor();
+            /**
+             * The length of a color string in hexadecimal format, e.g. "#ff8000"
+            */
+            static constexpr std::size_t HEX_STRING_LENGTH = 7;
+
+            /**
+             * The greatest length of a color string in decimal format, e.g. "rgb(255,128,0)"
+            */
+            static constexpr std::size_t MAX_RGB_STRING_LENGTH = 16;
+
+            /**
+             * Constructs black, with a hue, saturation and value of 0.
+            */
+            HsvColor() = default;
 
             /**
              * Constructs a new HsvColor with the given HSV components.
@@ -22,6 +44,17 @@ namespace cs19 {
             */
             HsvColor(float hue, float saturation, float value);
 
+            /**
+             * Returns the HSV color equivalent to the given 24-bit RGB components, whose red(),
+             * green() and blue() are those components again.
+             * @param red the red component, from 0 to 255
+             * @param green the green component, from 0 to 255
+             * @param blue the blue component, from 0 to 255
+             * @return the equivalent HsvColor
+             * @throws std::domain_error if a component is out of range
+            */
+            static HsvColor from_rgb(int red, int green, int blue);
+
             //HsvColor(HsvColor &old);
 
             /**
@@ -57,6 +90,26 @@ namespace cs19 {
             */
             std::string to_rgb_string() const;
 
+            /**
+             * Writes the string of to_hex_string() into a char buffer, without allocating memory,
+             * in the manner of std::to_chars(). No null terminator is written.
+             * @param first the start of the buffer
+             * @param last the end of the buffer
+             * @return a pointer past the last char written, or last with std::errc::value_too_large
+             *         if the buffer holds fewer than HEX_STRING_LENGTH chars
+            */
+            std::to_chars_result to_hex_chars(char *first, char *last) const;
+
+            /**
+             * Writes the string of to_rgb_string() into a char buffer, without allocating memory,
+             * in the manner of std::to_chars(). No null terminator is written.
+             * @param first the start of the buffer
+             * @param last the end of the buffer
+             * @return a pointer past the last char written, or last with std::errc::value_too_large
+             *         if the string does not fit, which it always does in MAX_RGB_STRING_LENGTH
+            */
+            std::to_chars_result to_rgb_chars(char *first, char *last) const;
+
             /**
              * Returns the hue component of this color in degrees
              * @return the degree hue component
@@ -94,16 +147,225 @@ namespace cs19 {
             int blue() const;
 
         private:
+            /**
+             * Returns the closest 8-bit RGB component with the given index (0 for red, 1 for
+             * green or 2 for blue) of this color
+             * @param index the index of the component
+             * @return the RGB component
+            */
+            int component(int index) const;
+
             float _hue {};
             float _saturation {};
             float _value {};
-            float C {};
-            float X {};
-            float m {};
-            float r {};
-            float g {};
-            float b {};
     };
+
+    static_assert(sizeof(HsvColor) == 3 * sizeof(float) &&
+                  std::is_trivially_copyable<HsvColor>::value,
+                  "HsvColor must stay three packed floats");
+
+    /**
+     * The layouts of packed 8-bit RGB pixel buffers: 3 bytes (red, green, blue) per pixel, or 4
+     * with an alpha byte that is always 255.
+    */
+    enum class RgbFormat { RGB8, RGBA8 };
+
+    /**
+     * Converts a buffer of HSV colors stored in separate planes into packed 8-bit RGB pixels, using
+     * SIMD when the CPU supports it. Every pixel gets exactly the components that red(), green()
+     * and blue() of the equivalent HsvColor return.
+     * @param hues the hue of each color in degrees, from 0 to 360
+     * @param saturations the saturation of each color, from 0 to 1
+     * @param values the value of each color, from 0 to 1
+     * @param count the number of colors
+     * @param rgb the buffer for the pixels: 3 or 4 bytes for each color, depending on format
+     * @param format the layout of the pixels
+     * @throws std::domain_error if a component is out of range or NaN, in which case the pixels
+     *         before it may have been written
+    */
+    void hsv_to_rgb(const float *hues, const float *saturations, const float *values,
+                    std::size_t count, std::uint8_t *rgb, RgbFormat format = RgbFormat::RGB8);
+
+    /**
+     * Converts a buffer of interleaved HSV colors into packed 8-bit RGB pixels, like the planar
+     * version.
+     * @param hsv the hue, saturation and value of each color in turn, with the ranges above
+     * @param count the number of colors, i.e. a third of the number of floats in hsv
+     * @param rgb the buffer for the pixels: 3 or 4 bytes for each color, depending on format
+     * @param format the layout of the pixels
+     * @throws std::domain_error if a component is out of range or NaN, in which case the pixels
+     *         before it may have been written
+    */
+    void hsv_to_rgb(const float *hsv, std::size_t count, std::uint8_t *rgb,
+                    RgbFormat format = RgbFormat::RGB8);
+
+    /**
+     * Converts an array of HsvColor objects into packed 8-bit RGB pixels, like the planar version.
+     * @param colors the colors to convert
+     * @param count the number of colors
+     * @param rgb the buffer for the pixels: 3 or 4 bytes for each color, depending on format
+     * @param format the layout of the pixels
+    */
+    void hsv_to_rgb(const HsvColor *colors, std::size_t count, std::uint8_t *rgb,
+                    RgbFormat format = RgbFormat::RGB8);
+
+    /**
+     * Converts a buffer of packed 8-bit RGB pixels (e.g. decoded from a BMP file) into HSV colors
+     * stored in separate planes, using SIMD when the CPU supports it. Each color is the one
+     * HsvColor::from_rgb() returns, so converting back with hsv_to_rgb() restores the pixels
+     * exactly.
+     * @param rgb the pixels: 3 or 4 bytes for each, depending on format; alpha is ignored
+     * @param count the number of pixels
+     * @param hues the buffer for the hue of each color in degrees, from 0 to 360
+     * @param saturations the buffer for the saturation of each color, from 0 to 1
+     * @param values the buffer for the value of each color, from 0 to 1
+     * @param format the layout of the pixels
+    */
+    void rgb_to_hsv(const std::uint8_t *rgb, std::size_t count, float *hues, float *saturations,
+                    float *values, RgbFormat format = RgbFormat::RGB8);
+
+    /**
+     * Converts a buffer of packed 8-bit RGB pixels into an array of HsvColor objects, like the
+     * planar version, e.g. for editing an image with the operators of HsvColor.
+     * @param rgb the pixels: 3 or 4 bytes for each, depending on format; alpha is ignored
+     * @param count the number of pixels
+     * @param colors the array for the colors
+     * @param format the layout of the pixels
+    */
+    void rgb_to_hsv(const std::uint8_t *rgb, std::size_t count, HsvColor *colors,
+                    RgbFormat format = RgbFormat::RGB8);
+
+    /**
+     * A lookup table of the 8-bit RGB components of every HSV color with a whole number of degrees
+     * of hue and whole percents of saturation and value, as 8-bit image pipelines quantize them, so
+     * that hsv_to_rgb() can look pixels up rather than compute them. The table is either computed
+     * with the batch conversion, so each entry is exactly what red(), green() and blue() return, or
+     * memory-mapped from a file written by save().
+     *
+     * Of the three components of a color, only the one between the largest and smallest depends on
+     * the hue; the other two depend on saturation and value alone. So the table holds a byte per
+     * color for the middle component and two bytes per saturation and value for the others: 3.7
+     * MB, a third of a table of whole pixels, at the cost of two lookups per pixel. With AVX2 the
+     * lookups are gathered eight pixels at a time; without it they are made one pixel at a time,
+     * which is slower than computing the pixels with the SSE2 kernel.
+    */
+    class HsvLut {
+        public:
+            static constexpr int HUES = 361;    // whole degrees of hue, from 0 to 360
+            static constexpr int LEVELS = 101;  // whole percents of saturation or value
+
+            /**
+             * Computes the table.
+            */
+            HsvLut();
+
+            HsvLut(HsvLut &&that) noexcept;
+            HsvLut &operator=(HsvLut &&that) noexcept;
+            ~HsvLut();
+
+            /**
+             * Memory-maps a table previously written by save(). The file is not read up front;
+             * pages are faulted in as lookups touch them.
+             * @param path the path of the file
+             * @return the mapped table
+             * @throws std::system_error if the file cannot be mapped
+             * @throws std::domain_error if the file is not a valid table
+            */
+            static HsvLut load(const std::string &path);
+
+            /**
+             * Writes this table to a file that load() can map.
+             * @param path the path of the file
+             * @throws std::system_error if the file cannot be written
+            */
+            void save(const std::string &path) const;
+
+            /**
+             * Returns the number of bytes in the table.
+             * @return the size of the table
+            */
+            std::size_t size_bytes() const;
+
+            /**
+             * Looks up the 8-bit RGB components of a quantized HSV color.
+             * @param hue the hue in whole degrees, from 0 to 360
+             * @param saturation the saturation in whole percents, from 0 to 100
+             * @param value the value in whole percents, from 0 to 100
+             * @param rgb the buffer for the red, green and blue components
+            */
+            void lookup(int hue, int saturation, int value, std::uint8_t *rgb) const;
+
+            /**
+             * Looks up the 8-bit RGB pixels of many quantized HSV colors stored in separate
+             * planes, as hsv_to_rgb() does given this table.
+             * @param hues the hue of each color in whole degrees, from 0 to 360
+             * @param saturations the saturation of each color in whole percents, from 0 to 100
+             * @param values the value of each color in whole percents, from 0 to 100
+             * @param count the number of colors
+             * @param rgb the buffer for the pixels: 3 or 4 bytes each, depending on format
+             * @param format the layout of the pixels
+             * @throws std::domain_error if a component is out of range, in which case the pixels
+             *         before it may have been written
+            */
+            void lookup(const std::uint16_t *hues, const std::uint8_t *saturations,
+                        const std::uint8_t *values, std::size_t count, std::uint8_t *rgb,
+                        RgbFormat format = RgbFormat::RGB8) const;
+
+        private:
+            struct Mapping;
+
+            explicit HsvLut(std::unique_ptr<Mapping> mapping);
+
+            std::vector<std::uint8_t> table_;   // the computed table, unless mapped
+            std::unique_ptr<Mapping> mapping_;  // the mapped file, unless computed
+            const std::uint8_t *extremes_ = nullptr;  // the largest and smallest component by
+                                                      // saturation, then value
+            const std::uint8_t *middles_ = nullptr;   // the middle component by saturation, then
+                                                      // value, then hue
+    };
+
+    /**
+     * Converts a buffer of quantized HSV colors stored in separate planes into packed 8-bit RGB
+     * pixels, by computing them like the float version or by looking them up in a table. Either
+     * way, every pixel gets exactly the components of the HsvColor with the given hue, and with the
+     * saturation and value divided by 100.
+     * @param hues the hue of each color in whole degrees, from 0 to 360
+     * @param saturations the saturation of each color in whole percents, from 0 to 100
+     * @param values the value of each color in whole percents, from 0 to 100
+     * @param count the number of colors
+     * @param rgb the buffer for the pixels: 3 or 4 bytes for each color, depending on format
+     * @param format the layout of the pixels
+     * @param lut the table in which to look colors up, or nullptr to compute them
+     * @throws std::domain_error if a component is out of range, in which case the pixels before it
+     *         may have been written
+    */
+    void hsv_to_rgb(const std::uint16_t *hues, const std::uint8_t *saturations,
+                    const std::uint8_t *values, std::size_t count, std::uint8_t *rgb,
+                    RgbFormat format = RgbFormat::RGB8, const HsvLut *lut = nullptr);
+
+    /**
+     * The formats of CSS-compatible color strings: hexadecimal as in HsvColor::to_hex_string(), or
+     * decimal as in HsvColor::to_rgb_string().
+    */
+    enum class ColorNotation { HEX, RGB };
+
+    /**
+     * Writes the strings of many colors one after another into a single char buffer, each followed
+     * by a separator, without allocating memory. The colors are converted to RGB in batches with
+     * hsv_to_rgb(), and the components are formatted by table lookup.
+     * @param colors the colors to format
+     * @param count the number of colors
+     * @param first the start of the buffer
+     * @param last the end of the buffer, which need be no further than count times one more than
+     *        HsvColor::HEX_STRING_LENGTH or HsvColor::MAX_RGB_STRING_LENGTH past first
+     * @param notation the format of the strings
+     * @param separator the char written after each string
+     * @return a pointer past the last char written, or last with std::errc::value_too_large if the
+     *         strings do not all fit, in which case those that fit may have been written
+    */
+    std::to_chars_result format_colors(const HsvColor *colors, std::size_t count, char *first,
+                                       char *last, ColorNotation notation,
+                                       char separator = '\n');
 }
 
 #endif // CS19_HSV_COLOR_H
\ No newline at end of file
@@ -0,0 +1,333 @@
+/**
+ * @file hsv_color_benchmark.cpp
+ *
+ * Benchmarks cs19::hsv_to_rgb() on video frames of random HSV colors, planar and interleaved, into
+ * RGB8 and RGBA8 pixels, against a loop constructing a cs19::HsvColor per pixel and reading its
+ * red(), green() and blue(). Reports megapixels per second for each, after checking that both
+ * produce identical pixels.
+ *
+ * A second table times the reverse conversion, cs19::rgb_to_hsv(), from RGB8 and RGBA8 frames into
+ * planes or an array of cs19::HsvColor, against a loop calling cs19::HsvColor::from_rgb() per
+ * pixel, after checking that both agree and that converting back restores every pixel.
+ *
+ * A third table times formatting a million colors as CSS strings, hexadecimal and decimal: one
+ * std::string per color with to_hex_string()/to_rgb_string(), into a char buffer per color with
+ * to_hex_chars()/to_rgb_chars(), and all into one buffer with cs19::format_colors(). It reports
+ * millions of colors per second and the bytes heap-allocated per color.
+ *
+ * A fourth table weighs cs19::HsvLut, which trades 3.7 MB of memory for computation, on 1080p
+ * frames of whole-degree hues and whole-percent saturations and values: cs19::hsv_to_rgb()
+ * computing each pixel, looking it up in a computed table, and looking it up in a table mapped from
+ * disk. One frame is random, so lookups land all over the table and miss cache; the other is a
+ * smooth gradient, like most of a video frame, so they stay within a few cache lines. Before
+ * timing, every entry of the table is checked against red(), green() and blue(), and the time to
+ * compute, save and map the table is reported.
+ *
+ * Build: g++ -std=c++17 -O2 hsv_color_benchmark.cpp cs19_hsv_color.cpp -o hsv_color_benchmark
+ * Usage: hsv_color_benchmark
+ */
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cs19_hsv_color.h"
+
+// Count every byte requested from the global heap, so formatting can report its allocations.
+static std::atomic<std::size_t> bytes_allocated{0};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"  // new and delete below both use malloc
+#endif
+
+void *operator new(std::size_t size) {
+  bytes_allocated += size;
+  if (void *memory = std::malloc(size ? size : 1))
+    return memory;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+volatile std::size_t sink = 0;  // keeps the optimizer from discarding results
+
+// Runs fn repeatedly until at least ~0.2 s have elapsed; returns mean seconds per call.
+template <typename Function>
+double time_per_call(Function fn) {
+  using clock = std::chrono::steady_clock;
+  std::size_t calls = 0;
+  auto start = clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+    fn();
+    ++calls;
+    elapsed = clock::now() - start;
+  } while (elapsed.count() < 0.2);
+  return elapsed.count() / calls;
+}
+
+// One pixel at a time through HsvColor, as a baseline
+void convert_per_color(const float *hsv, std::size_t stride, std::size_t plane,
+                       std::size_t count, std::uint8_t *rgb, std::size_t channels) {
+  for (std::size_t i = 0; i < count; ++i, rgb += channels) {
+    const float *color = hsv + i * stride;
+    cs19::HsvColor converted(color[0], color[plane], color[2 * plane]);
+    rgb[0] = static_cast<std::uint8_t>(converted.red());
+    rgb[1] = static_cast<std::uint8_t>(converted.green());
+    rgb[2] = static_cast<std::uint8_t>(converted.blue());
+    if (channels == 4)
+      rgb[3] = 255;
+  }
+}
+
+void benchmark(const char *frame, std::size_t width, std::size_t height) {
+  std::size_t count = width * height;
+  std::mt19937 engine(1);
+  std::uniform_real_distribution<float> hue(0, 360), fraction(0, 1);
+  std::vector<float> planes(3 * count), interleaved(3 * count);
+  for (std::size_t i = 0; i < count; ++i) {
+    interleaved[3 * i] = planes[i] = hue(engine);
+    interleaved[3 * i + 1] = planes[count + i] = fraction(engine);
+    interleaved[3 * i + 2] = planes[2 * count + i] = fraction(engine);
+  }
+
+  for (bool planar : {true, false}) {
+    for (cs19::RgbFormat format : {cs19::RgbFormat::RGB8, cs19::RgbFormat::RGBA8}) {
+      std::size_t channels = format == cs19::RgbFormat::RGBA8 ? 4 : 3;
+      std::vector<std::uint8_t> pixels(count * channels), expected(count * channels);
+      auto convert = [&] {
+        if (planar)
+          cs19::hsv_to_rgb(&planes[0], &planes[count], &planes[2 * count], count, pixels.data(),
+                           format);
+        else
+          cs19::hsv_to_rgb(interleaved.data(), count, pixels.data(), format);
+        sink = sink + pixels[0];
+      };
+      auto baseline = [&] {
+        if (planar)
+          convert_per_color(planes.data(), 1, count, count, expected.data(), channels);
+        else
+          convert_per_color(interleaved.data(), 3, 1, count, expected.data(), channels);
+        sink = sink + expected[0];
+      };
+      convert();
+      baseline();
+      assert(pixels == expected);
+
+      double cs19_seconds = time_per_call(convert), baseline_seconds = time_per_call(baseline);
+      std::printf("%-9s %-12s %-6s %12.1f %14.1f %9.2fx\n", frame,
+                  planar ? "planar" : "interleaved", channels == 4 ? "RGBA8" : "RGB8",
+                  count / cs19_seconds / 1e6, count / baseline_seconds / 1e6,
+                  baseline_seconds / cs19_seconds);
+    }
+  }
+}
+
+void benchmark_reverse(const char *frame, std::size_t width, std::size_t height) {
+  std::size_t count = width * height;
+  std::mt19937 engine(3);
+  std::vector<std::uint8_t> rgba(4 * count);
+  for (auto &byte : rgba)
+    byte = static_cast<std::uint8_t>(engine());
+  std::vector<std::uint8_t> rgb(3 * count);
+  for (std::size_t i = 0; i < count; ++i) {
+    for (int channel = 0; channel < 3; ++channel)
+      rgb[3 * i + channel] = rgba[4 * i + channel];
+  }
+
+  std::vector<float> planes(3 * count);
+  std::vector<cs19::HsvColor> colors(count), expected(count);
+  for (bool planar : {true, false}) {
+    for (cs19::RgbFormat format : {cs19::RgbFormat::RGB8, cs19::RgbFormat::RGBA8}) {
+      std::size_t channels = format == cs19::RgbFormat::RGBA8 ? 4 : 3;
+      const std::uint8_t *pixels = channels == 4 ? rgba.data() : rgb.data();
+      auto convert = [&] {
+        if (planar)
+          cs19::rgb_to_hsv(pixels, count, &planes[0], &planes[count], &planes[2 * count],
+                           format);
+        else
+          cs19::rgb_to_hsv(pixels, count, colors.data(), format);
+        sink = sink + static_cast<std::size_t>(planar ? planes[0] : colors[0].hue());
+      };
+      auto baseline = [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+          const std::uint8_t *pixel = pixels + i * channels;
+          expected[i] = cs19::HsvColor::from_rgb(pixel[0], pixel[1], pixel[2]);
+        }
+        sink = sink + static_cast<std::size_t>(expected[0].hue());
+      };
+      convert();
+      baseline();
+      std::vector<std::uint8_t> restored(count * channels);
+      if (planar)
+        cs19::hsv_to_rgb(&planes[0], &planes[count], &planes[2 * count], count, restored.data(),
+                         format);
+      else
+        cs19::hsv_to_rgb(colors.data(), count, restored.data(), format);
+      for (std::size_t i = 0; i < count; ++i) {
+        if (!planar)
+          assert(colors[i].hue() == expected[i].hue() && colors[i].value() == expected[i].value());
+        for (std::size_t channel = 0; channel < 3; ++channel)
+          assert(restored[i * channels + channel] == pixels[i * channels + channel]);
+      }
+
+      double cs19_seconds = time_per_call(convert), baseline_seconds = time_per_call(baseline);
+      std::printf("%-9s %-12s %-6s %12.1f %14.1f %9.2fx\n", frame, planar ? "planar" : "HsvColor",
+                  channels == 4 ? "RGBA8" : "RGB8", count / cs19_seconds / 1e6,
+                  count / baseline_seconds / 1e6, baseline_seconds / cs19_seconds);
+    }
+  }
+}
+
+// Returns the bytes heap-allocated by a single call of fn.
+template <typename Function>
+std::size_t bytes_per_call(Function fn) {
+  std::size_t before = bytes_allocated;
+  fn();
+  return bytes_allocated - before;
+}
+
+void benchmark_formatting(std::size_t count) {
+  std::mt19937 engine(2);
+  std::uniform_real_distribution<float> hue(0, 360), fraction(0, 1);
+  std::vector<cs19::HsvColor> colors;
+  for (std::size_t i = 0; i < count; ++i)
+    colors.emplace_back(hue(engine), fraction(engine), fraction(engine));
+  std::vector<char> buffer(count * (cs19::HsvColor::MAX_RGB_STRING_LENGTH + 1));
+  char *first = buffer.data(), *last = first + buffer.size();
+
+  for (cs19::ColorNotation notation : {cs19::ColorNotation::HEX, cs19::ColorNotation::RGB}) {
+    bool hex = notation == cs19::ColorNotation::HEX;
+    std::string expected;
+    for (const auto &color : colors)
+      expected += (hex ? color.to_hex_string() : color.to_rgb_string()) + '\n';
+    auto result = cs19::format_colors(colors.data(), count, first, last, notation);
+    assert(result.ec == std::errc() && std::string(first, result.ptr) == expected);
+
+    auto strings = [&] {
+      for (const auto &color : colors)
+        sink = sink + (hex ? color.to_hex_string() : color.to_rgb_string()).size();
+    };
+    auto chars = [&] {
+      char *out = first;
+      for (const auto &color : colors) {
+        out = (hex ? color.to_hex_chars(out, last) : color.to_rgb_chars(out, last)).ptr;
+        *out++ = '\n';
+      }
+      sink = sink + (out - first);
+    };
+    auto batch = [&] {
+      sink = sink + (cs19::format_colors(colors.data(), count, first, last, notation).ptr - first);
+    };
+    struct Method {
+      const char *name;
+      std::size_t bytes;
+      double seconds;
+    } methods[] = {
+        {hex ? "to_hex_string" : "to_rgb_string", bytes_per_call(strings), time_per_call(strings)},
+        {hex ? "to_hex_chars" : "to_rgb_chars", bytes_per_call(chars), time_per_call(chars)},
+        {"format_colors", bytes_per_call(batch), time_per_call(batch)},
+    };
+    for (const Method &method : methods)
+      std::printf("%-9s %-16s %12.1f %14.1f\n", hex ? "hex" : "rgb", method.name,
+                  count / method.seconds / 1e6, static_cast<double>(method.bytes) / count);
+  }
+}
+
+// Returns the seconds taken by a single call of fn.
+template <typename Function>
+double seconds_of(Function fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmark_lut(std::size_t width, std::size_t height) {
+  const char *path = "hsv_color_benchmark.lut";
+  cs19::HsvLut computed;
+  double compute_seconds = seconds_of([&] { computed = cs19::HsvLut(); });
+  double save_seconds = seconds_of([&] { computed.save(path); });
+  cs19::HsvLut mapped = cs19::HsvLut::load(path);
+  double load_seconds = seconds_of([&] { mapped = cs19::HsvLut::load(path); });
+  std::printf("table: %zu bytes, computed in %.1f ms, saved in %.1f ms, mapped in %.3f ms\n\n",
+              computed.size_bytes(), compute_seconds * 1e3, save_seconds * 1e3,
+              load_seconds * 1e3);
+  for (int hue = 0; hue < cs19::HsvLut::HUES; ++hue) {
+    for (int saturation = 0; saturation < cs19::HsvLut::LEVELS; ++saturation) {
+      for (int value = 0; value < cs19::HsvLut::LEVELS; ++value) {
+        cs19::HsvColor color(hue, saturation / 100.0f, value / 100.0f);
+        std::uint8_t rgb[3], mapped_rgb[3];
+        computed.lookup(hue, saturation, value, rgb);
+        mapped.lookup(hue, saturation, value, mapped_rgb);
+        assert(rgb[0] == color.red() && rgb[1] == color.green() && rgb[2] == color.blue());
+        assert(std::memcmp(rgb, mapped_rgb, 3) == 0);
+      }
+    }
+  }
+
+  std::printf("%-9s %-14s %12s\n", "frame", "conversion", "MP/s");
+  std::size_t count = width * height;
+  std::mt19937 engine(4);
+  std::vector<std::uint16_t> hues(count);
+  std::vector<std::uint8_t> saturations(count), values(count);
+  for (bool random : {true, false}) {
+    for (std::size_t i = 0; i < count; ++i) {
+      std::size_t x = i % width, y = i / width;
+      hues[i] = static_cast<std::uint16_t>(random ? engine() % 361 : x * 360 / width);
+      saturations[i] = static_cast<std::uint8_t>(random ? engine() % 101 : 40 + y * 60 / height);
+      values[i] = static_cast<std::uint8_t>(random ? engine() % 101 : 90 - y * 50 / height);
+    }
+    std::vector<std::uint8_t> pixels(3 * count), expected(3 * count);
+    cs19::hsv_to_rgb(hues.data(), saturations.data(), values.data(), count, expected.data());
+    struct Method {
+      const char *name;
+      const cs19::HsvLut *lut;
+    } methods[] = {{"compute", nullptr}, {"computed LUT", &computed}, {"mapped LUT", &mapped}};
+    for (const Method &method : methods) {
+      auto convert = [&] {
+        cs19::hsv_to_rgb(hues.data(), saturations.data(), values.data(), count, pixels.data(),
+                         cs19::RgbFormat::RGB8, method.lut);
+        sink = sink + pixels[0];
+      };
+      convert();
+      assert(pixels == expected);
+      std::printf("%-9s %-14s %12.1f\n", random ? "random" : "gradient", method.name,
+                  count / time_per_call(convert) / 1e6);
+    }
+  }
+  std::remove(path);
+}
+
+}  // namespace
+
+int main() {
+  std::printf("%-9s %-12s %-6s %12s %14s %10s\n", "frame", "layout", "format", "batch MP/s",
+              "HsvColor MP/s", "speedup");
+  benchmark("720p", 1280, 720);
+  benchmark("1080p", 1920, 1080);
+  benchmark("2160p", 3840, 2160);
+  std::printf("\n%-9s %-12s %-6s %12s %14s %10s\n", "frame", "layout", "format", "batch MP/s",
+              "from_rgb MP/s", "speedup");
+  benchmark_reverse("1080p", 1920, 1080);
+  std::printf("\n%-9s %-16s %12s %14s\n", "notation", "function", "M colors/s", "bytes/color");
+  benchmark_formatting(1000000);
+  std::printf("\n");
+  benchmark_lut(1920, 1080);
+  return static_cast<int>(sink & 0);
+}